@@ -0,0 +1,751 @@
+// 采集基准用的 V4L2 替身，编译为共享库后通过 LD_PRELOAD 注入被测程序
+// （main.cpp、main2.cpp ~ main4.cpp 都直接使用 open/ioctl/mmap，不需要修改）。
+//
+// 两种模式：
+//   BENCH_V4L2_FAKE=N  在进程内模拟 N 个相机，节点为 /dev/video0、/dev/video2 ... /dev/video(2N-2)
+//                      （与旧版本 camera_id*2 的节点约定一致），按帧率产生 YUYV 帧；
+//                      没有排队的缓冲区时像真实驱动一样丢帧，sequence 照常递增
+//   BENCH_V4L2_FAKE=0  不模拟，只观察真实设备（例如 vivid 虚拟驱动）上的 DQBUF/QBUF
+//
+// 两种模式都按同样的口径统计每个设备节点：
+//   出队延迟  驱动时间戳（帧就绪）到 DQBUF 返回
+//   占用时间  DQBUF 到同一缓冲区重新 QBUF，包含处理和保存
+//   丢帧      DQBUF 看到的 sequence 间隔
+// 进程退出时把报告写到 BENCH_V4L2_REPORT 指定的文件（默认 stderr）。
+// 其他环境变量：BENCH_V4L2_FPS 模拟相机的默认帧率（默认30，被测程序可用 VIDIOC_S_PARM 修改）
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "disk_writer.h"
+
+#define BENCH_EXPORT extern "C" __attribute__((visibility("default")))
+
+namespace {
+
+constexpr int MAX_FDS = 4096;
+constexpr int MAX_BUFFERS = 32;
+
+int64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+int64_t thread_cpu_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+template <typename Fn>
+Fn next_symbol(const char* name) {
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+}
+
+using OpenFn = int (*)(const char*, int, ...);
+using OpenatFn = int (*)(int, const char*, int, ...);
+using IoctlFn = int (*)(int, unsigned long, ...);
+using MmapFn = void* (*)(void*, size_t, int, int, int, off_t);
+using CloseFn = int (*)(int);
+using AccessFn = int (*)(const char*, int);
+using OpendirFn = DIR* (*)(const char*);
+using ReaddirFn = struct dirent* (*)(DIR*);
+using ClosedirFn = int (*)(DIR*);
+
+// 每个设备节点的统计，重新打开（掉线重连）时累加
+struct NodeStats {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<int64_t> first_ns{0};
+    std::atomic<int64_t> last_ns{0};
+    std::atomic<int64_t> generator_cpu_ns{0};
+    LatencyHistogram dequeue;
+    LatencyHistogram hold;
+};
+
+// 一个打开的设备描述符
+struct Device {
+    int node = 0;
+    bool fake = false;
+    bool nonblock = false;
+    NodeStats* stats = nullptr;
+    int64_t last_sequence = -1;
+    std::array<int64_t, MAX_BUFFERS> dequeue_ns{};  // 各缓冲区 DQBUF 的时间，0表示在驱动手里
+
+    // 以下只用于模拟设备
+    int memfd = -1;
+    uint8_t* memory = nullptr;   // 替身自己的映射，产生帧时写入
+    size_t mapped_size = 0;
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t sizeimage = 1280 * 720 * 2;
+    size_t buffer_stride = 0;    // 缓冲区在 memfd 中的间隔，按页对齐
+    int num_buffers = 0;
+    int fps = 30;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> queued;      // 已 QBUF，等待填充
+    struct Done {
+        int index;
+        uint32_t sequence;
+        int64_t timestamp_ns;
+    };
+    std::deque<Done> done;       // 已填充，等待 DQBUF
+    uint32_t sequence = 0;
+    bool streaming = false;
+    std::thread generator;
+};
+
+// 第一次调用任何替换函数时初始化（可能早于本库的构造函数）。
+// 不析构：本库的析构函数在 exit 的 atexit 处理之后才运行，那时还要输出报告
+struct State {
+    State();
+
+    int fake_cameras = 0;
+    int default_fps = 30;
+    std::string report_path;
+
+    OpenFn real_open = nullptr;
+    OpenFn real_open64 = nullptr;
+    OpenatFn real_openat = nullptr;
+    IoctlFn real_ioctl = nullptr;
+    MmapFn real_mmap = nullptr;
+    CloseFn real_close = nullptr;
+    AccessFn real_access = nullptr;
+    OpendirFn real_opendir = nullptr;
+    ReaddirFn real_readdir = nullptr;
+    ClosedirFn real_closedir = nullptr;
+
+    std::array<std::atomic<Device*>, MAX_FDS> devices{};
+    std::mutex stats_mutex;
+    std::map<int, std::unique_ptr<NodeStats>> stats;
+
+    // 枚举 /dev 时追加的模拟节点
+    struct DevDir {
+        int next_fake = 0;
+        struct dirent entry;
+    };
+    std::mutex dir_mutex;
+    std::map<DIR*, DevDir> dev_dirs;
+};
+
+State& state() {
+    static State* s = new State;
+    return *s;
+}
+
+// 路径为 /dev/videoN 时返回 N，否则返回-1
+int video_node(const char* path) {
+    if (path == nullptr || strncmp(path, "/dev/video", 10) != 0) {
+        return -1;
+    }
+    char* end = nullptr;
+    long node = strtol(path + 10, &end, 10);
+    return (end != path + 10 && *end == '\0') ? static_cast<int>(node) : -1;
+}
+
+bool is_fake_node(int node) {
+    return node >= 0 && node % 2 == 0 && node / 2 < state().fake_cameras;
+}
+
+NodeStats* node_stats(int node) {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.stats_mutex);
+    auto& stats = s.stats[node];
+    if (!stats) {
+        stats = std::make_unique<NodeStats>();
+    }
+    return stats.get();
+}
+
+Device* device_of(int fd) {
+    if (fd < 0 || fd >= MAX_FDS) {
+        return nullptr;
+    }
+    return state().devices[fd].load(std::memory_order_acquire);
+}
+
+// ---------- 统计 ----------
+
+void on_dequeued(Device* dev, const struct v4l2_buffer& buf) {
+    int64_t now = monotonic_ns();
+    int64_t timestamp = static_cast<int64_t>(buf.timestamp.tv_sec) * 1000000000 + buf.timestamp.tv_usec * 1000;
+    NodeStats* stats = dev->stats;
+    stats->dequeue.record(now - timestamp);
+    stats->frames.fetch_add(1, std::memory_order_relaxed);
+    if (dev->last_sequence >= 0 && buf.sequence > dev->last_sequence + 1) {
+        stats->dropped.fetch_add(buf.sequence - dev->last_sequence - 1, std::memory_order_relaxed);
+    }
+    dev->last_sequence = buf.sequence;
+    int64_t expected = 0;
+    stats->first_ns.compare_exchange_strong(expected, now, std::memory_order_relaxed);
+    stats->last_ns.store(now, std::memory_order_relaxed);
+    if (buf.index < MAX_BUFFERS) {
+        dev->dequeue_ns[buf.index] = now;
+    }
+}
+
+void on_queued(Device* dev, const struct v4l2_buffer& buf) {
+    if (buf.index < MAX_BUFFERS && dev->dequeue_ns[buf.index] != 0) {
+        dev->stats->hold.record(monotonic_ns() - dev->dequeue_ns[buf.index]);
+        dev->dequeue_ns[buf.index] = 0;
+    }
+}
+
+// ---------- 模拟设备 ----------
+
+// 模拟设备的描述符是 eventfd：done 非空时计数为1，为空时清零，
+// 这样被测程序的 epoll/select 看到的可读状态与真实设备一致
+void set_readable(int fd, bool readable) {
+    eventfd_t value = 1;
+    if (readable) {
+        eventfd_write(fd, value);
+    } else {
+        eventfd_read(fd, &value);
+    }
+}
+
+void generator_loop(Device* dev, int fd) {
+    int64_t start_cpu = thread_cpu_ns();
+    int64_t next = monotonic_ns();
+    std::unique_lock<std::mutex> lock(dev->mutex);
+    while (dev->streaming) {
+        int64_t period = 1000000000LL / std::max(1, dev->fps);
+        next += period;
+        lock.unlock();
+        struct timespec wake = {static_cast<time_t>(next / 1000000000), static_cast<long>(next % 1000000000)};
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, nullptr);
+        lock.lock();
+        if (!dev->streaming) {
+            break;
+        }
+        uint32_t sequence = dev->sequence++;
+        if (dev->queued.empty()) {
+            continue;  // 没有空闲缓冲区，驱动丢帧
+        }
+        int index = dev->queued.front();
+        dev->queued.pop_front();
+        lock.unlock();
+        // 整帧重写一遍，代替DMA把帧数据写入内存（这部分CPU时间单独统计，从被测程序中扣除）
+        uint8_t* frame = dev->memory + dev->buffer_stride * index;
+        memset(frame, static_cast<int>(sequence & 0xff), dev->sizeimage);
+        int64_t timestamp = monotonic_ns();
+        lock.lock();
+        if (!dev->streaming) {
+            break;
+        }
+        bool was_empty = dev->done.empty();
+        dev->done.push_back({index, sequence, timestamp});
+        if (was_empty) {
+            set_readable(fd, true);
+        }
+        dev->ready.notify_all();
+    }
+    dev->stats->generator_cpu_ns.fetch_add(thread_cpu_ns() - start_cpu, std::memory_order_relaxed);
+}
+
+void stop_streaming(Device* dev, int fd) {
+    {
+        std::lock_guard<std::mutex> lock(dev->mutex);
+        if (!dev->streaming) {
+            return;
+        }
+        dev->streaming = false;
+        dev->queued.clear();
+        dev->done.clear();
+        set_readable(fd, false);
+        dev->ready.notify_all();
+    }
+    dev->generator.join();
+    dev->dequeue_ns.fill(0);
+}
+
+void release_buffers(Device* dev) {
+    if (dev->memory != nullptr) {
+        munmap(dev->memory, dev->mapped_size);
+        dev->memory = nullptr;
+    }
+    if (dev->memfd != -1) {
+        state().real_close(dev->memfd);
+        dev->memfd = -1;
+    }
+    dev->num_buffers = 0;
+}
+
+void fill_format(const Device* dev, struct v4l2_format* fmt) {
+    fmt->fmt.pix.width = dev->width;
+    fmt->fmt.pix.height = dev->height;
+    fmt->fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
+    fmt->fmt.pix.field = V4L2_FIELD_NONE;
+    fmt->fmt.pix.bytesperline = dev->width * 2;
+    fmt->fmt.pix.sizeimage = dev->sizeimage;
+    fmt->fmt.pix.colorspace = V4L2_COLORSPACE_SRGB;
+}
+
+int fake_error(int error) {
+    errno = error;
+    return -1;
+}
+
+int fake_ioctl(Device* dev, int fd, unsigned long request, void* arg) {
+    switch (request) {
+    case VIDIOC_QUERYCAP: {
+        auto* cap = static_cast<struct v4l2_capability*>(arg);
+        memset(cap, 0, sizeof(*cap));
+        snprintf(reinterpret_cast<char*>(cap->driver), sizeof(cap->driver), "bench_v4l2");
+        snprintf(reinterpret_cast<char*>(cap->card), sizeof(cap->card), "Bench fake camera %d", dev->node / 2);
+        snprintf(reinterpret_cast<char*>(cap->bus_info), sizeof(cap->bus_info), "fake:video%d", dev->node);
+        cap->device_caps = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_STREAMING;
+        cap->capabilities = cap->device_caps | V4L2_CAP_DEVICE_CAPS;
+        return 0;
+    }
+    case VIDIOC_ENUM_FMT: {
+        auto* desc = static_cast<struct v4l2_fmtdesc*>(arg);
+        if (desc->index != 0 || desc->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+            return fake_error(EINVAL);
+        }
+        desc->pixelformat = V4L2_PIX_FMT_YUYV;
+        snprintf(reinterpret_cast<char*>(desc->description), sizeof(desc->description), "YUYV 4:2:2");
+        return 0;
+    }
+    case VIDIOC_ENUM_FRAMESIZES: {
+        auto* size = static_cast<struct v4l2_frmsizeenum*>(arg);
+        if (size->index != 0 || size->pixel_format != V4L2_PIX_FMT_YUYV) {
+            return fake_error(EINVAL);
+        }
+        size->type = V4L2_FRMSIZE_TYPE_STEPWISE;
+        size->stepwise = {2, 4096, 2, 2, 4096, 2};
+        return 0;
+    }
+    case VIDIOC_G_FMT:
+    case VIDIOC_S_FMT:
+    case VIDIOC_TRY_FMT: {
+        auto* fmt = static_cast<struct v4l2_format*>(arg);
+        if (fmt->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+            return fake_error(EINVAL);
+        }
+        if (request != VIDIOC_G_FMT) {
+            if (request == VIDIOC_S_FMT && dev->num_buffers > 0) {
+                return fake_error(EBUSY);
+            }
+            // 只支持 YUYV，其他格式像真实驱动一样改写为支持的格式
+            uint32_t width = std::clamp<uint32_t>(fmt->fmt.pix.width & ~1u, 2, 4096);
+            uint32_t height = std::clamp<uint32_t>(fmt->fmt.pix.height & ~1u, 2, 4096);
+            if (request == VIDIOC_S_FMT) {
+                dev->width = width;
+                dev->height = height;
+                dev->sizeimage = width * height * 2;
+            } else {
+                Device probe;
+                probe.width = width;
+                probe.height = height;
+                probe.sizeimage = width * height * 2;
+                fill_format(&probe, fmt);
+                return 0;
+            }
+        }
+        fill_format(dev, fmt);
+        return 0;
+    }
+    case VIDIOC_G_PARM:
+    case VIDIOC_S_PARM: {
+        auto* parm = static_cast<struct v4l2_streamparm*>(arg);
+        if (parm->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+            return fake_error(EINVAL);
+        }
+        struct v4l2_fract& frame_time = parm->parm.capture.timeperframe;
+        if (request == VIDIOC_S_PARM && frame_time.numerator != 0 && frame_time.denominator != 0) {
+            std::lock_guard<std::mutex> lock(dev->mutex);
+            dev->fps = std::clamp<int>(static_cast<int>(frame_time.denominator / frame_time.numerator), 1, 1000);
+        }
+        parm->parm.capture.capability = V4L2_CAP_TIMEPERFRAME;
+        frame_time.numerator = 1;
+        frame_time.denominator = dev->fps;
+        return 0;
+    }
+    case VIDIOC_REQBUFS: {
+        auto* req = static_cast<struct v4l2_requestbuffers*>(arg);
+        if (req->memory != V4L2_MEMORY_MMAP || req->type != V4L2_BUF_TYPE_VIDEO_CAPTURE) {
+            return fake_error(EINVAL);
+        }
+        if (dev->streaming) {
+            return fake_error(EBUSY);
+        }
+        release_buffers(dev);
+        if (req->count == 0) {
+            return 0;
+        }
+        req->count = std::clamp<uint32_t>(req->count, 2, MAX_BUFFERS);
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        dev->buffer_stride = (dev->sizeimage + page - 1) / page * page;
+        dev->mapped_size = dev->buffer_stride * req->count;
+        dev->memfd = memfd_create("bench_v4l2", MFD_CLOEXEC);
+        if (dev->memfd == -1 || ftruncate(dev->memfd, static_cast<off_t>(dev->mapped_size)) == -1) {
+            int error = errno;
+            release_buffers(dev);
+            return fake_error(error);
+        }
+        void* memory = state().real_mmap(nullptr, dev->mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, dev->memfd, 0);
+        if (memory == MAP_FAILED) {
+            int error = errno;
+            release_buffers(dev);
+            return fake_error(error);
+        }
+        dev->memory = static_cast<uint8_t*>(memory);
+        dev->num_buffers = static_cast<int>(req->count);
+        return 0;
+    }
+    case VIDIOC_QUERYBUF:
+    case VIDIOC_QBUF: {
+        auto* buf = static_cast<struct v4l2_buffer*>(arg);
+        if (buf->type != V4L2_BUF_TYPE_VIDEO_CAPTURE || buf->index >= static_cast<uint32_t>(dev->num_buffers)) {
+            return fake_error(EINVAL);
+        }
+        buf->memory = V4L2_MEMORY_MMAP;
+        buf->length = dev->sizeimage;
+        buf->m.offset = static_cast<uint32_t>(dev->buffer_stride * buf->index);
+        buf->flags = V4L2_BUF_FLAG_MAPPED | V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+        if (request == VIDIOC_QBUF) {
+            on_queued(dev, *buf);
+            std::lock_guard<std::mutex> lock(dev->mutex);
+            dev->queued.push_back(static_cast<int>(buf->index));
+            buf->flags |= V4L2_BUF_FLAG_QUEUED;
+        }
+        return 0;
+    }
+    case VIDIOC_DQBUF: {
+        auto* buf = static_cast<struct v4l2_buffer*>(arg);
+        std::unique_lock<std::mutex> lock(dev->mutex);
+        if (dev->done.empty()) {
+            if (!dev->streaming) {
+                return fake_error(EINVAL);
+            }
+            if (dev->nonblock) {
+                return fake_error(EAGAIN);
+            }
+            dev->ready.wait(lock, [dev] { return !dev->done.empty() || !dev->streaming; });
+            if (dev->done.empty()) {
+                return fake_error(EINVAL);
+            }
+        }
+        Device::Done frame = dev->done.front();
+        dev->done.pop_front();
+        if (dev->done.empty()) {
+            set_readable(fd, false);
+        }
+        lock.unlock();
+        buf->index = static_cast<uint32_t>(frame.index);
+        buf->memory = V4L2_MEMORY_MMAP;
+        buf->length = dev->sizeimage;
+        buf->bytesused = dev->sizeimage;
+        buf->m.offset = static_cast<uint32_t>(dev->buffer_stride * frame.index);
+        buf->flags = V4L2_BUF_FLAG_MAPPED | V4L2_BUF_FLAG_DONE | V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+        buf->field = V4L2_FIELD_NONE;
+        buf->sequence = frame.sequence;
+        buf->timestamp.tv_sec = frame.timestamp_ns / 1000000000;
+        buf->timestamp.tv_usec = (frame.timestamp_ns % 1000000000) / 1000;
+        on_dequeued(dev, *buf);
+        return 0;
+    }
+    case VIDIOC_STREAMON: {
+        if (dev->num_buffers == 0) {
+            return fake_error(EINVAL);
+        }
+        std::lock_guard<std::mutex> lock(dev->mutex);
+        if (!dev->streaming) {
+            dev->streaming = true;
+            dev->sequence = 0;
+            dev->last_sequence = -1;
+            dev->generator = std::thread(generator_loop, dev, fd);
+        }
+        return 0;
+    }
+    case VIDIOC_STREAMOFF:
+        stop_streaming(dev, fd);
+        return 0;
+    default:
+        return fake_error(ENOTTY);
+    }
+}
+
+// ---------- 描述符跟踪 ----------
+
+int track_open(int fd, const char* path, int flags) {
+    int node = video_node(path);
+    if (fd == -1 || node < 0 || fd >= MAX_FDS) {
+        return fd;
+    }
+    auto* dev = new Device;
+    dev->node = node;
+    dev->nonblock = (flags & O_NONBLOCK) != 0;
+    dev->stats = node_stats(node);
+    state().devices[fd].store(dev, std::memory_order_release);
+    return fd;
+}
+
+int open_fake(const char* path, int flags) {
+    // eventfd 只用作可读通知，总是非阻塞；阻塞式 DQBUF 在条件变量上等待
+    int fd = eventfd(0, EFD_NONBLOCK | ((flags & O_CLOEXEC) ? EFD_CLOEXEC : 0));
+    if (fd == -1) {
+        return -1;
+    }
+    if (fd >= MAX_FDS) {
+        state().real_close(fd);
+        return fake_error(EMFILE);
+    }
+    track_open(fd, path, flags);
+    Device* dev = device_of(fd);
+    dev->fake = true;
+    dev->fps = state().default_fps;
+    return fd;
+}
+
+void write_report() {
+    State& s = state();
+    FILE* out = s.report_path.empty() ? stderr : fopen(s.report_path.c_str(), "w");
+    if (out == nullptr) {
+        fprintf(stderr, "无法写入基准报告：%s - %s\n", s.report_path.c_str(), strerror(errno));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(s.stats_mutex);
+    uint64_t total_frames = 0;
+    uint64_t total_dropped = 0;
+    int64_t generator_cpu = 0;
+    for (const auto& [node, stats] : s.stats) {
+        uint64_t frames = stats->frames.load();
+        uint64_t dropped = stats->dropped.load();
+        double seconds = (stats->last_ns.load() - stats->first_ns.load()) / 1e9;
+        fprintf(out,
+                "node /dev/video%d frames=%llu dropped=%llu drop_rate=%.2f%% fps=%.1f "
+                "dequeue_us p50=%lld p99=%lld p999=%lld hold_us p50=%lld p99=%lld p999=%lld\n",
+                node, static_cast<unsigned long long>(frames), static_cast<unsigned long long>(dropped),
+                frames + dropped > 0 ? 100.0 * dropped / (frames + dropped) : 0.0, seconds > 0 ? (frames - 1) / seconds : 0.0,
+                static_cast<long long>(stats->dequeue.percentile(50) / 1000),
+                static_cast<long long>(stats->dequeue.percentile(99) / 1000),
+                static_cast<long long>(stats->dequeue.percentile(99.9) / 1000),
+                static_cast<long long>(stats->hold.percentile(50) / 1000),
+                static_cast<long long>(stats->hold.percentile(99) / 1000),
+                static_cast<long long>(stats->hold.percentile(99.9) / 1000));
+        total_frames += frames;
+        total_dropped += dropped;
+        generator_cpu += stats->generator_cpu_ns.load();
+    }
+    fprintf(out, "total frames=%llu dropped=%llu generator_cpu_ns=%lld\n", static_cast<unsigned long long>(total_frames),
+            static_cast<unsigned long long>(total_dropped), static_cast<long long>(generator_cpu));
+    if (out != stderr) {
+        fclose(out);
+    }
+}
+
+State::State() {
+    State& s = *this;
+    s.real_open = next_symbol<OpenFn>("open");
+    s.real_open64 = next_symbol<OpenFn>("open64");
+    s.real_openat = next_symbol<OpenatFn>("openat");
+    s.real_ioctl = next_symbol<IoctlFn>("ioctl");
+    s.real_mmap = next_symbol<MmapFn>("mmap");
+    s.real_close = next_symbol<CloseFn>("close");
+    s.real_access = next_symbol<AccessFn>("access");
+    s.real_opendir = next_symbol<OpendirFn>("opendir");
+    s.real_readdir = next_symbol<ReaddirFn>("readdir");
+    s.real_closedir = next_symbol<ClosedirFn>("closedir");
+    if (const char* value = getenv("BENCH_V4L2_FAKE")) {
+        s.fake_cameras = std::max(0, atoi(value));
+    }
+    if (const char* value = getenv("BENCH_V4L2_FPS")) {
+        s.default_fps = std::clamp(atoi(value), 1, 1000);
+    }
+    if (const char* value = getenv("BENCH_V4L2_REPORT")) {
+        s.report_path = value;
+    }
+}
+
+// 被测程序没有关闭的模拟设备在这里停止，然后输出报告
+__attribute__((destructor)) void bench_fini() {
+    State& s = state();
+    for (int fd = 0; fd < MAX_FDS; ++fd) {
+        Device* dev = s.devices[fd].load();
+        if (dev != nullptr && dev->fake) {
+            stop_streaming(dev, fd);
+        }
+    }
+    write_report();
+}
+
+int open_with_mode(OpenFn real, const char* path, int flags, va_list args) {
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        mode = va_arg(args, mode_t);
+    }
+    if (is_fake_node(video_node(path))) {
+        return open_fake(path, flags);
+    }
+    return track_open(real(path, flags, mode), path, flags);
+}
+
+}  // namespace
+
+// ---------- 替换的库函数 ----------
+
+BENCH_EXPORT int open(const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    int fd = open_with_mode(state().real_open, path, flags, args);
+    va_end(args);
+    return fd;
+}
+
+BENCH_EXPORT int open64(const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    int fd = open_with_mode(state().real_open64, path, flags, args);
+    va_end(args);
+    return fd;
+}
+
+BENCH_EXPORT int openat(int dirfd, const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        mode = va_arg(args, mode_t);
+    }
+    va_end(args);
+    if (is_fake_node(video_node(path))) {
+        return open_fake(path, flags);
+    }
+    return track_open(state().real_openat(dirfd, path, flags, mode), path, flags);
+}
+
+BENCH_EXPORT int ioctl(int fd, unsigned long request, ...) {
+    va_list args;
+    va_start(args, request);
+    void* arg = va_arg(args, void*);
+    va_end(args);
+
+    Device* dev = device_of(fd);
+    if (dev != nullptr && dev->fake) {
+        return fake_ioctl(dev, fd, request, arg);
+    }
+    if (dev != nullptr && request == VIDIOC_QBUF) {
+        on_queued(dev, *static_cast<struct v4l2_buffer*>(arg));
+    }
+    int result = state().real_ioctl(fd, request, arg);
+    if (dev != nullptr && result == 0) {
+        if (request == VIDIOC_DQBUF) {
+            on_dequeued(dev, *static_cast<struct v4l2_buffer*>(arg));
+        } else if (request == VIDIOC_STREAMON) {
+            dev->last_sequence = -1;
+        } else if (request == VIDIOC_STREAMOFF) {
+            dev->dequeue_ns.fill(0);
+        }
+    }
+    return result;
+}
+
+// 模拟设备的缓冲区映射到对应 memfd 的同一偏移，被测程序自己 munmap
+BENCH_EXPORT void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    Device* dev = device_of(fd);
+    if (dev != nullptr && dev->fake) {
+        if (dev->memfd == -1 || static_cast<size_t>(offset) + length > dev->mapped_size) {
+            errno = EINVAL;
+            return MAP_FAILED;
+        }
+        fd = dev->memfd;
+    }
+    return state().real_mmap(addr, length, prot, flags, fd, offset);
+}
+
+BENCH_EXPORT int close(int fd) {
+    if (fd >= 0 && fd < MAX_FDS) {
+        Device* dev = state().devices[fd].exchange(nullptr);
+        if (dev != nullptr) {
+            if (dev->fake) {
+                stop_streaming(dev, fd);
+                release_buffers(dev);
+            }
+            delete dev;
+        }
+    }
+    return state().real_close(fd);
+}
+
+BENCH_EXPORT int access(const char* path, int mode) {
+    if (is_fake_node(video_node(path))) {
+        return 0;
+    }
+    return state().real_access(path, mode);
+}
+
+// 枚举 /dev 时隐藏同名的真实节点，并在最后追加模拟节点，供 main.cpp 的设备发现使用
+BENCH_EXPORT DIR* opendir(const char* path) {
+    State& s = state();
+    DIR* dir = s.real_opendir(path);
+    if (dir != nullptr && s.fake_cameras > 0 && strcmp(path, "/dev") == 0) {
+        std::lock_guard<std::mutex> lock(s.dir_mutex);
+        s.dev_dirs[dir] = State::DevDir{};
+    }
+    return dir;
+}
+
+BENCH_EXPORT struct dirent* readdir(DIR* dir) {
+    State& s = state();
+    State::DevDir* dev_dir = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s.dir_mutex);
+        auto it = s.dev_dirs.find(dir);
+        if (it != s.dev_dirs.end()) {
+            dev_dir = &it->second;
+        }
+    }
+    if (dev_dir == nullptr) {
+        return s.real_readdir(dir);
+    }
+    while (struct dirent* entry = s.real_readdir(dir)) {
+        std::string path = std::string("/dev/") + entry->d_name;
+        if (!is_fake_node(video_node(path.c_str()))) {
+            return entry;
+        }
+    }
+    if (dev_dir->next_fake >= s.fake_cameras) {
+        return nullptr;
+    }
+    memset(&dev_dir->entry, 0, sizeof(dev_dir->entry));
+    dev_dir->entry.d_type = DT_CHR;
+    snprintf(dev_dir->entry.d_name, sizeof(dev_dir->entry.d_name), "video%d", dev_dir->next_fake * 2);
+    ++dev_dir->next_fake;
+    return &dev_dir->entry;
+}
+
+BENCH_EXPORT int closedir(DIR* dir) {
+    State& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.dir_mutex);
+        s.dev_dirs.erase(dir);
+    }
+    return s.real_closedir(dir);
+}
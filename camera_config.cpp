@@ -0,0 +1,303 @@
+#include "camera_config.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <linux/videodev2.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace {
+
+// 读取 sysfs 文件的第一行
+std::string read_sysfs_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// USB 序列号位于接口目录的上一级（USB设备目录）
+std::string usb_serial(const std::string& node_name) {
+    return read_sysfs_line("/sys/class/video4linux/" + node_name + "/device/../serial");
+}
+
+std::vector<uint32_t> enum_formats(int fd) {
+    std::vector<uint32_t> formats;
+    struct v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    while (ioctl(fd, VIDIOC_ENUM_FMT, &desc) == 0) {
+        formats.push_back(desc.pixelformat);
+        ++desc.index;
+    }
+    return formats;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> enum_frame_sizes(int fd, uint32_t pixelformat, bool& discrete) {
+    std::vector<std::pair<uint32_t, uint32_t>> sizes;
+    struct v4l2_frmsizeenum size;
+    memset(&size, 0, sizeof(size));
+    size.pixel_format = pixelformat;
+    discrete = true;
+    while (ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0) {
+        if (size.type != V4L2_FRMSIZE_TYPE_DISCRETE) {
+            // 连续或按步进的范围只有一项，记录最大值
+            discrete = false;
+            sizes.emplace_back(size.stepwise.max_width, size.stepwise.max_height);
+            break;
+        }
+        sizes.emplace_back(size.discrete.width, size.discrete.height);
+        ++size.index;
+    }
+    return sizes;
+}
+
+// /dev/videoN 中的 N，用于排序
+int node_number(const std::string& name) {
+    return std::atoi(name.c_str() + strlen("video"));
+}
+
+}  // namespace
+
+uint32_t parse_pixelformat(const std::string& name) {
+    if (name == "yuyv") {
+        return V4L2_PIX_FMT_YUYV;
+    }
+    if (name == "mjpeg") {
+        return V4L2_PIX_FMT_MJPEG;
+    }
+    return 0;
+}
+
+std::string pixelformat_name(uint32_t pixelformat) {
+    std::string name(4, ' ');
+    for (int i = 0; i < 4; ++i) {
+        name[i] = static_cast<char>((pixelformat >> (8 * i)) & 0xff);
+    }
+    return name;
+}
+
+std::vector<DeviceInfo> discover_devices(bool report_errors) {
+    std::vector<std::string> names;
+    DIR* dir = opendir("/dev");
+    if (dir == nullptr) {
+        std::cerr << "无法打开目录：/dev - " << strerror(errno) << std::endl;
+        return {};
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "video", 5) == 0) {
+            names.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+        return node_number(a) < node_number(b);
+    });
+
+    std::vector<DeviceInfo> devices;
+    for (const std::string& name : names) {
+        std::string path = "/dev/" + name;
+        int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1) {
+            if (report_errors) {
+                std::cerr << "无法打开设备：" << path << " - " << strerror(errno) << std::endl;
+            }
+            continue;
+        }
+        struct v4l2_capability cap;
+        memset(&cap, 0, sizeof(cap));
+        bool capture = false;
+        if (ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0) {
+            uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+            capture = (caps & V4L2_CAP_VIDEO_CAPTURE) && (caps & V4L2_CAP_STREAMING);
+        }
+        if (capture) {
+            DeviceInfo info;
+            info.path = path;
+            info.card = reinterpret_cast<const char*>(cap.card);
+            info.bus_info = reinterpret_cast<const char*>(cap.bus_info);
+            info.serial = usb_serial(name);
+            info.formats = enum_formats(fd);
+            devices.push_back(std::move(info));
+        }
+        close(fd);
+    }
+    return devices;
+}
+
+void print_devices(const std::vector<DeviceInfo>& devices) {
+    if (devices.empty()) {
+        std::cout << "没有发现视频采集设备" << std::endl;
+        return;
+    }
+    for (const DeviceInfo& info : devices) {
+        std::cout << info.path << "：" << info.card << "，bus=" << info.bus_info;
+        if (!info.serial.empty()) {
+            std::cout << "，serial=" << info.serial;
+        }
+        std::cout << std::endl;
+
+        int fd = open(info.path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        for (uint32_t format : info.formats) {
+            std::cout << "  " << pixelformat_name(format) << "：";
+            if (fd != -1) {
+                bool discrete = true;
+                for (const auto& [width, height] : enum_frame_sizes(fd, format, discrete)) {
+                    std::cout << (discrete ? "" : "最大 ") << width << "x" << height << " ";
+                }
+            }
+            std::cout << std::endl;
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+}
+
+bool device_supports(const std::string& path, uint32_t pixelformat, uint32_t width, uint32_t height) {
+    int fd = open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    bool supported = false;
+    std::vector<uint32_t> formats = enum_formats(fd);
+    if (std::find(formats.begin(), formats.end(), pixelformat) != formats.end()) {
+        bool discrete = true;
+        auto sizes = enum_frame_sizes(fd, pixelformat, discrete);
+        supported = sizes.empty() || !discrete ||
+                    std::find(sizes.begin(), sizes.end(), std::make_pair(width, height)) != sizes.end();
+    }
+    close(fd);
+    return supported;
+}
+
+bool load_camera_config(const std::string& path, const CameraConfig& defaults, std::vector<CameraConfig>& cameras) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "无法打开配置文件：" << path << " - " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    cameras.clear();
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream words(line);
+        std::string word;
+        if (!(words >> word)) {
+            continue;
+        }
+        if (word != "camera") {
+            std::cerr << path << ":" << line_number << "：未知的配置项 " << word << std::endl;
+            return false;
+        }
+
+        CameraConfig camera = defaults;
+        while (words >> word) {
+            size_t equal = word.find('=');
+            if (equal == std::string::npos) {
+                std::cerr << path << ":" << line_number << "：应为 键=值：" << word << std::endl;
+                return false;
+            }
+            std::string key = word.substr(0, equal);
+            std::string value = word.substr(equal + 1);
+            if (key == "bus" || key == "serial" || key == "device" || key == "replay" || key == "synthetic") {
+                camera.match_key = key;
+                camera.match_value = value;
+            } else if (key == "track") {
+                camera.replay_track = std::atoi(value.c_str());
+            } else if (key == "speed") {
+                if (value != "original" && value != "max") {
+                    std::cerr << path << ":" << line_number << "：speed 应为 original 或 max：" << value << std::endl;
+                    return false;
+                }
+                camera.replay_max_speed = value == "max";
+            } else if (key == "loop") {
+                camera.replay_loop = value != "0";
+            } else if (key == "width") {
+                camera.width = static_cast<uint32_t>(std::max(1, std::atoi(value.c_str())));
+            } else if (key == "height") {
+                camera.height = static_cast<uint32_t>(std::max(1, std::atoi(value.c_str())));
+            } else if (key == "format") {
+                camera.pixelformat = parse_pixelformat(value);
+                if (camera.pixelformat == 0) {
+                    std::cerr << path << ":" << line_number << "：未知的像素格式 " << value << std::endl;
+                    return false;
+                }
+            } else if (key == "fps") {
+                camera.fps = std::max(0, std::atoi(value.c_str()));
+            } else if (key == "buffers") {
+                camera.buffers = std::max(2, std::atoi(value.c_str()));
+            } else if (key == "weight") {
+                camera.weight = std::max(1, std::atoi(value.c_str()));
+            } else if (key == "pretrigger") {
+                camera.pretrigger_seconds = std::max(0.0, std::atof(value.c_str()));
+            } else if (key == "pretrigger_mb") {
+                camera.pretrigger_mb = std::max(1, std::atoi(value.c_str()));
+            } else {
+                std::cerr << path << ":" << line_number << "：未知的键 " << key << std::endl;
+                return false;
+            }
+        }
+        if (camera.match_key.empty()) {
+            std::cerr << path << ":" << line_number << "：缺少 bus、serial、device、replay 或 synthetic" << std::endl;
+            return false;
+        }
+        cameras.push_back(camera);
+    }
+    return true;
+}
+
+bool resolve_camera_device(CameraConfig& camera, const std::vector<DeviceInfo>& devices) {
+    if (!uses_device(camera)) {
+        camera.device = camera.match_key == "replay" ? camera.match_value : "synthetic:" + camera.match_value;
+        return true;
+    }
+    camera.device.clear();
+    for (const DeviceInfo& info : devices) {
+        const std::string& value = camera.match_key == "bus" ? info.bus_info
+                                   : camera.match_key == "serial" ? info.serial
+                                                                  : info.path;
+        if (value == camera.match_value) {
+            camera.device = info.path;
+            return true;
+        }
+    }
+    return false;
+}
+
+void resolve_camera_devices(std::vector<CameraConfig>& cameras, const std::vector<DeviceInfo>& devices) {
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        if (!resolve_camera_device(cameras[i], devices)) {
+            std::cerr << "相机 " << i << " 没有找到设备：" << cameras[i].match_key << "=" << cameras[i].match_value << std::endl;
+        }
+    }
+}
+
+std::vector<CameraConfig> default_camera_config(const std::vector<DeviceInfo>& devices, const CameraConfig& defaults,
+                                                int max_cameras) {
+    std::vector<CameraConfig> cameras;
+    for (const DeviceInfo& info : devices) {
+        if (static_cast<int>(cameras.size()) == max_cameras) {
+            break;
+        }
+        CameraConfig camera = defaults;
+        camera.match_key = "bus";
+        camera.match_value = info.bus_info;
+        camera.device = info.path;
+        cameras.push_back(camera);
+    }
+    return cameras;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 相机发现与每个相机的配置。
+//
+// 设备通过扫描 /dev/video* 并用 VIDIOC_QUERYCAP 过滤出视频采集节点得到
+// （UVC 相机还会额外提供不能采集的元数据节点），用 bus_info 和 USB 序列号识别，
+// 不依赖重启后可能变化的节点编号。
+//
+// 配置文件每行描述一个相机，行号顺序即相机编号，# 之后为注释：
+//
+//   camera bus=usb-0000:00:14.0-1 width=1280 height=720 format=mjpeg fps=30 buffers=4 weight=60
+//   camera serial=SN0012 width=640 height=480
+//   camera device=/dev/video4
+//   camera replay=data/record_1700000000 track=2 speed=max loop=1
+//   camera synthetic=test width=1920 height=1080 fps=60
+//
+// bus、serial、device 三者选一个用于匹配设备，其余键可省略，省略时使用命令行给出的默认值。
+// replay 回放录制的容器分段，值为分段文件、录制的路径前缀（按序拼接所有分段）或目录（track 只取其中一个相机的帧，speed=original|max，loop=1 循环），
+// synthetic 产生测试图，两者都不需要设备，见 capture_source.h。
+// weight 是录制帧池中的调度权重，省略时取帧率，见 slot_scheduler.h。
+// pretrigger 是事件触发前保留的秒数，pretrigger_mb 是预触发环的内存上限，见 pretrigger_ring.h。
+
+// 发现的视频采集设备
+struct DeviceInfo {
+    std::string path;       // /dev/videoN
+    std::string card;       // 设备名称
+    std::string bus_info;   // 例如 usb-0000:00:14.0-1，对同一个USB口是稳定的
+    std::string serial;     // USB序列号，没有时为空
+    std::vector<uint32_t> formats;  // 支持的像素格式
+};
+
+// 一个相机的配置
+struct CameraConfig {
+    std::string match_key;   // "bus"、"serial"、"device"，或不使用设备的 "replay"、"synthetic"
+    std::string match_value; // 回放时为分段文件、录制前缀或目录，合成时为名称
+    std::string device;      // 匹配到的设备节点，没有匹配到时为空
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t pixelformat = 0;
+    int fps = 0;             // 0表示使用驱动默认值
+    int buffers = 0;
+    int weight = 0;          // 录制帧池的调度权重，0表示按帧率
+    double pretrigger_seconds = 0.0;  // 事件触发前保留的秒数，0表示不保留
+    int pretrigger_mb = 0;            // 预触发环的内存上限（MB）
+    int replay_track = -1;   // 只回放这个相机编号的帧，-1表示全部
+    bool replay_max_speed = false;
+    bool replay_loop = false;
+};
+
+// 相机是否使用 V4L2 设备（而不是回放或合成）
+inline bool uses_device(const CameraConfig& camera) {
+    return camera.match_key != "replay" && camera.match_key != "synthetic";
+}
+
+// 枚举所有视频采集设备，按节点编号排序。report_errors 为false时不输出打不开的节点，
+// 用于相机掉线后每秒重试的查找，避免同一个没有权限的节点反复刷屏
+std::vector<DeviceInfo> discover_devices(bool report_errors = true);
+
+// 输出设备、支持的格式和分辨率（VIDIOC_ENUM_FMT / VIDIOC_ENUM_FRAMESIZES）
+void print_devices(const std::vector<DeviceInfo>& devices);
+
+// 设备是否支持该格式和分辨率。驱动不支持 VIDIOC_ENUM_FRAMESIZES 或只给出范围时返回true
+bool device_supports(const std::string& path, uint32_t pixelformat, uint32_t width, uint32_t height);
+
+// 读取配置文件，省略的键使用 defaults 中的值。失败时返回false并输出原因
+bool load_camera_config(const std::string& path, const CameraConfig& defaults, std::vector<CameraConfig>& cameras);
+
+// 按 bus_info、序列号或节点路径为相机找到设备节点，找不到时 device 为空并返回false。
+// 回放和合成相机的 device 为描述字符串，总是返回true
+bool resolve_camera_device(CameraConfig& camera, const std::vector<DeviceInfo>& devices);
+// 为每个相机找到设备节点，并输出找不到设备的相机
+void resolve_camera_devices(std::vector<CameraConfig>& cameras, const std::vector<DeviceInfo>& devices);
+
+// 没有配置文件时每个发现的设备各作为一个相机，最多 max_cameras 个
+std::vector<CameraConfig> default_camera_config(const std::vector<DeviceInfo>& devices, const CameraConfig& defaults,
+                                                int max_cameras);
+
+// 解析 "yuyv"、"mjpeg"，未知格式返回0
+uint32_t parse_pixelformat(const std::string& name);
+// 像素格式的 fourcc 字符串
+std::string pixelformat_name(uint32_t pixelformat);
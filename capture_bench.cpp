@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <signal.h>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// 采集流水线基准：在 libbench_v4l2.so（见 bench_v4l2.cpp）之上运行被测程序，
+// 按固定节奏通过标准输入发送 's' 触发保存，结束时发送 'q'，最后汇总
+// 每个相机的帧率、丢帧率、出队延迟和缓冲区占用时间的分位数，以及每帧的CPU时间。
+//
+//   capture_bench --cameras 6 --fps 30 --duration 20 -- ./multi_camera_capture --no-preview
+//   capture_bench --cameras 6 --duration 20 -- ./main4
+//   capture_bench --real --duration 20 -- ./multi_camera_capture   # vivid 等真实设备，只观察
+//
+// 被测程序的CPU时间来自 wait4，已扣除替身产生帧的时间，只包含被测程序自己。
+
+namespace {
+
+struct Options {
+    int cameras = 6;
+    int fps = 30;
+    int duration = 10;
+    int snapshot_interval_ms = 1000;  // 0表示不触发保存
+    bool real = false;
+    bool verbose = false;
+    std::string shim;
+    std::vector<std::string> command;
+};
+
+// 默认使用与本程序在同一目录的 libbench_v4l2.so
+std::string default_shim() {
+    char path[4096];
+    ssize_t n = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (n <= 0) {
+        return "libbench_v4l2.so";
+    }
+    path[n] = '\0';
+    std::string dir(path);
+    return dir.substr(0, dir.rfind('/') + 1) + "libbench_v4l2.so";
+}
+
+void write_key(int fd, char key) {
+    if (write(fd, &key, 1) == -1 && errno != EPIPE) {
+        std::cerr << "写入被测程序标准输入失败：" << strerror(errno) << std::endl;
+    }
+}
+
+double timeval_seconds(const struct timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    int i = 1;
+    for (; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cameras" && i + 1 < argc) {
+            options.cameras = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--fps" && i + 1 < argc) {
+            options.fps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--duration" && i + 1 < argc) {
+            options.duration = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--snapshot-interval" && i + 1 < argc) {
+            options.snapshot_interval_ms = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--real") {
+            options.real = true;
+        } else if (arg == "--shim" && i + 1 < argc) {
+            options.shim = argv[++i];
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (arg == "--") {
+            ++i;
+            break;
+        } else {
+            break;
+        }
+    }
+    for (; i < argc; ++i) {
+        options.command.push_back(argv[i]);
+    }
+    if (options.command.empty()) {
+        std::cerr << "用法：" << argv[0] << " [--cameras N] [--fps N] [--duration 秒] [--snapshot-interval 毫秒]"
+                  << " [--real] [--shim 路径] [--verbose] -- 程序 [参数...]" << std::endl;
+        return 1;
+    }
+    if (options.shim.empty()) {
+        options.shim = default_shim();
+    }
+    if (access(options.shim.c_str(), R_OK) != 0) {
+        std::cerr << "找不到替身库：" << options.shim << " - " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    char report_path[] = "/tmp/capture_bench_XXXXXX";
+    int report_fd = mkstemp(report_path);
+    if (report_fd == -1) {
+        std::cerr << "创建报告文件失败：" << strerror(errno) << std::endl;
+        return 1;
+    }
+    close(report_fd);
+
+    int input[2];
+    if (pipe(input) == -1) {
+        std::cerr << "创建管道失败：" << strerror(errno) << std::endl;
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == -1) {
+        std::cerr << "fork失败：" << strerror(errno) << std::endl;
+        return 1;
+    }
+    if (pid == 0) {
+        dup2(input[0], STDIN_FILENO);
+        close(input[0]);
+        close(input[1]);
+        if (!options.verbose) {
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        setenv("LD_PRELOAD", options.shim.c_str(), 1);
+        setenv("BENCH_V4L2_FAKE", options.real ? "0" : std::to_string(options.cameras).c_str(), 1);
+        setenv("BENCH_V4L2_FPS", std::to_string(options.fps).c_str(), 1);
+        setenv("BENCH_V4L2_REPORT", report_path, 1);
+        std::vector<char*> args;
+        for (std::string& arg : options.command) {
+            args.push_back(arg.data());
+        }
+        args.push_back(nullptr);
+        execvp(args[0], args.data());
+        std::cerr << "无法运行：" << args[0] << " - " << strerror(errno) << std::endl;
+        _exit(127);
+    }
+    close(input[0]);
+
+    // 按节奏触发保存，到时间后请求退出
+    int snapshots = 0;
+    auto end = start + std::chrono::seconds(options.duration);
+    auto next_snapshot = start + std::chrono::milliseconds(options.snapshot_interval_ms);
+    while (std::chrono::steady_clock::now() < end && waitpid(pid, nullptr, WNOHANG) == 0) {
+        auto wake = std::min(end, std::chrono::steady_clock::now() + std::chrono::milliseconds(100));
+        if (options.snapshot_interval_ms > 0 && next_snapshot <= wake) {
+            std::this_thread::sleep_until(next_snapshot);
+            write_key(input[1], 's');
+            ++snapshots;
+            next_snapshot += std::chrono::milliseconds(options.snapshot_interval_ms);
+        } else {
+            std::this_thread::sleep_until(wake);
+        }
+    }
+    write_key(input[1], 'q');
+    close(input[1]);
+
+    // 被测程序可能卡在保存上，依次等待、SIGINT、SIGKILL
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    int signals_sent = 0;
+    while (true) {
+        pid_t done = wait4(pid, &status, WNOHANG, &usage);
+        if (done == pid) {
+            break;
+        }
+        if (done == -1) {
+            std::cerr << "等待被测程序失败：" << strerror(errno) << std::endl;
+            break;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            int sig = signals_sent == 0 ? SIGINT : SIGKILL;
+            std::cerr << "被测程序没有按时退出，发送" << (sig == SIGINT ? "SIGINT" : "SIGKILL") << std::endl;
+            kill(pid, sig);
+            ++signals_sent;
+            deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ifstream report_file(report_path);
+    std::stringstream report;
+    report << report_file.rdbuf();
+    unlink(report_path);
+
+    unsigned long long frames = 0;
+    unsigned long long dropped = 0;
+    long long generator_cpu_ns = 0;
+    std::string line;
+    bool found_total = false;
+    while (std::getline(report, line)) {
+        std::cout << line << std::endl;
+        if (sscanf(line.c_str(), "total frames=%llu dropped=%llu generator_cpu_ns=%lld", &frames, &dropped,
+                   &generator_cpu_ns) == 3) {
+            found_total = true;
+        }
+    }
+    if (!found_total) {
+        std::cerr << "没有读到替身报告，被测程序可能被强制结束" << std::endl;
+    }
+
+    double cpu = timeval_seconds(usage.ru_utime) + timeval_seconds(usage.ru_stime) - generator_cpu_ns / 1e9;
+    std::cout << "---- " << options.command[0] << "：运行 " << wall << " 秒，触发保存 " << snapshots << " 次 ----" << std::endl;
+    std::cout << "吞吐 " << frames / wall << " 帧/秒，丢帧率 "
+              << (frames + dropped > 0 ? 100.0 * dropped / (frames + dropped) : 0.0) << "%，CPU " << cpu << " 秒（"
+              << (frames > 0 ? cpu * 1e6 / frames : 0.0) << " 微秒/帧），最大常驻内存 " << usage.ru_maxrss / 1024
+              << " MB" << std::endl;
+    if (WIFSIGNALED(status)) {
+        std::cout << "被测程序被信号 " << WTERMSIG(status) << " 结束" << std::endl;
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+        std::cout << "被测程序退出码 " << WEXITSTATUS(status) << std::endl;
+    }
+    return found_total ? 0 : 1;
+}
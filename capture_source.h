@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/videodev2.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "camera_config.h"
+
+// 采集源：采集反应器和 BufferLease 只通过这个接口取帧和归还缓冲区，
+// 不关心帧来自 V4L2 设备、录制文件回放还是合成数据。
+//
+// 与 V4L2 的 mmap 流程一致：源持有固定数量的缓冲区，dequeue 取出一个已填充的缓冲区，
+// 使用者处理完后用 requeue 归还；缓冲区都被借出时源像驱动一样丢帧（sequence 照常递增）。
+// fd() 在有帧可取时可读，用于 epoll。dequeue 只在采集反应器线程中调用，
+// requeue 可以在任意线程（例如保存线程写盘完成后）调用。
+
+// 取出的一帧，对应 v4l2_buffer 中用到的字段
+struct CapturedFrame {
+    uint32_t index = 0;          // 缓冲区编号，归还时使用
+    uint32_t sequence = 0;
+    int64_t timestamp_us = 0;    // CLOCK_MONOTONIC
+    size_t size = 0;             // 有效字节数（bytesused）
+    bool monotonic = true;       // 时间戳是否为单调时钟
+};
+
+class CaptureSource {
+public:
+    enum class Result {
+        Frame,   // 取到一帧
+        Empty,   // 暂时没有帧，等 fd() 可读后再取
+        End,     // 回放结束，不会再有帧
+        Error,   // 设备出错（掉线等），需要关闭后重新打开
+    };
+
+    virtual ~CaptureSource() = default;
+
+    // 按配置协商格式、分配缓冲区并开始出帧，失败时输出原因并释放已申请的资源
+    virtual bool open(const CameraConfig& config) = 0;
+    // 停止出帧并释放缓冲区，调用前所有缓冲区必须已归还
+    virtual void close() = 0;
+
+    virtual int fd() const = 0;
+    virtual Result dequeue(CapturedFrame& frame) = 0;
+    virtual void requeue(uint32_t index) = 0;
+
+    virtual const uint8_t* data(uint32_t index) const = 0;
+    // 缓冲区可读的字节数，不小于帧的有效字节数
+    virtual size_t capacity(uint32_t index) const = 0;
+    virtual int buffer_count() const = 0;
+
+    // 协商后的格式，sizeimage 为单帧最大字节数
+    const struct v4l2_pix_format& format() const { return format_; }
+    // 源确认的帧间隔（微秒），0表示未知
+    int64_t frame_interval_us() const { return frame_interval_us_; }
+
+protected:
+    struct v4l2_pix_format format_ {};
+    int64_t frame_interval_us_ = 0;
+};
+
+// 按相机配置的 match_key 创建采集源：replay、synthetic 或 V4L2 设备
+std::unique_ptr<CaptureSource> make_capture_source(int camera_id, const CameraConfig& config);
+
+// 回放的录制（分段文件、路径前缀或目录，见 recording_segments）中出现的相机编号，
+// 按编号排序。打不开时输出原因并返回空
+std::vector<int> replay_tracks(const std::string& path);
+// 用回放录制中第一帧的格式和分辨率覆盖配置，预览等按配置分配的资源据此确定大小
+bool probe_replay_format(CameraConfig& config);
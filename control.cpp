@@ -0,0 +1,594 @@
+#include "control.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/gpio.h>
+#include <linux/input.h>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+constexpr size_t MAX_LINE = 1024;  // 文本命令的最大长度，超出时断开连接
+
+int64_t control_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 按 ':' 拆分设备参数
+std::vector<std::string> split_spec(const std::string& spec) {
+    std::vector<std::string> parts;
+    std::stringstream in(spec);
+    std::string part;
+    while (std::getline(in, part, ':')) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+// 从缓冲区中取出完整的行，处理后剩下不完整的部分
+template <typename Fn>
+void take_lines(std::string& buffer, Fn on_line) {
+    size_t start = 0;
+    size_t newline;
+    while ((newline = buffer.find('\n', start)) != std::string::npos) {
+        std::string line = buffer.substr(start, newline - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        on_line(line);
+        start = newline + 1;
+    }
+    buffer.erase(0, start);
+}
+
+// ---------- 标准输入 ----------
+
+class StdinSource : public ControlSource {
+public:
+    int fd() const override { return STDIN_FILENO; }
+    const std::string& name() const override { return name_; }
+
+    bool read(std::vector<ControlCommand>& commands) override {
+        // 不修改标准输入的阻塞属性（与终端共享），poll 报告可读后读一次不会阻塞
+        char keys[64];
+        ssize_t n = ::read(STDIN_FILENO, keys, sizeof(keys));
+        if (n == 0) {
+            return false;
+        }
+        if (n < 0) {
+            return errno == EINTR || errno == EAGAIN;
+        }
+        int64_t now = control_now_us();
+        for (ssize_t i = 0; i < n; ++i) {
+            const char* command = nullptr;
+            switch (keys[i]) {
+            case 's': command = "snapshot"; break;
+            case 't': command = "sync"; break;
+            case 'e': command = "event"; break;
+            case 'r': command = "record"; break;
+            case 'q': command = "stop"; break;
+            default: continue;
+            }
+            ControlCommand c;
+            c.name = command;
+            c.timestamp_us = now;
+            c.received_us = now;
+            c.source = name_;
+            commands.push_back(c);
+        }
+        return true;
+    }
+
+private:
+    std::string name_ = "stdin";
+};
+
+// ---------- Unix 套接字 ----------
+
+// 监听套接字和所有连接放在内部的 epoll 集合中，fd() 返回这个集合，
+// 分发线程的 epoll 可以直接等待它
+class SocketSource : public ControlSource {
+public:
+    ~SocketSource() override {
+        for (auto& [client, buffer] : clients_) {
+            close(client);
+        }
+        if (listen_fd_ != -1) {
+            close(listen_fd_);
+            unlink(path_.c_str());
+        }
+        if (epoll_fd_ != -1) {
+            close(epoll_fd_);
+        }
+    }
+
+    bool open(const std::string& path) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "控制套接字路径太长：" << path << std::endl;
+            return false;
+        }
+        memcpy(addr.sun_path, path.c_str(), path.size());
+
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+        if (epoll_fd_ == -1 || listen_fd_ == -1) {
+            std::cerr << "创建控制套接字失败：" << strerror(errno) << std::endl;
+            return false;
+        }
+        unlink(path.c_str());
+        if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 || listen(listen_fd_, 8) == -1) {
+            std::cerr << "绑定控制套接字失败：" << path << " - " << strerror(errno) << std::endl;
+            close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+        path_ = path;
+        name_ = "socket:" + path;
+        watch(listen_fd_);
+        return true;
+    }
+
+    int fd() const override { return epoll_fd_; }
+    const std::string& name() const override { return name_; }
+
+    bool read(std::vector<ControlCommand>& commands) override {
+        struct epoll_event events[16];
+        int n = epoll_wait(epoll_fd_, events, 16, 0);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                int client;
+                while ((client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) != -1) {
+                    clients_[client];
+                    watch(client);
+                }
+            } else if (!read_client(fd, commands)) {
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+                clients_.erase(fd);
+                close(fd);
+            }
+        }
+        return true;
+    }
+
+private:
+    void watch(int fd) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    // 读取连接上的命令并逐条回复，连接关闭或出错时返回false
+    bool read_client(int client, std::vector<ControlCommand>& commands) {
+        std::string& buffer = clients_[client];
+        char data[512];
+        bool open = true;
+        while (true) {
+            ssize_t n = recv(client, data, sizeof(data), 0);
+            if (n == 0) {
+                open = false;
+                break;
+            }
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                open = errno == EAGAIN || errno == EWOULDBLOCK;
+                break;
+            }
+            buffer.append(data, static_cast<size_t>(n));
+        }
+        int64_t now = control_now_us();
+        std::string replies;
+        take_lines(buffer, [&](const std::string& line) {
+            if (line.find_first_not_of(" \t") == std::string::npos) {
+                return;
+            }
+            ControlCommand command;
+            std::string error;
+            if (parse_control_command(line, now, command, error)) {
+                command.source = name_;
+                commands.push_back(command);
+                replies += "ok " + command.name + " " + std::to_string(command.timestamp_us) + "\n";
+            } else {
+                replies += "error " + error + "\n";
+            }
+        });
+        if (!replies.empty()) {
+            // 回复很短，客户端不读时丢弃
+            send(client, replies.data(), replies.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        }
+        // 对端关闭写方向前发来的命令已经处理并回复
+        return open && buffer.size() <= MAX_LINE;
+    }
+
+    std::string path_;
+    std::string name_;
+    int epoll_fd_ = -1;
+    int listen_fd_ = -1;
+    std::unordered_map<int, std::string> clients_;  // 连接和尚未读完整的行
+};
+
+// ---------- 命名管道 ----------
+
+class FifoSource : public ControlSource {
+public:
+    ~FifoSource() override {
+        if (fd_ != -1) {
+            close(fd_);
+        }
+        if (keep_open_fd_ != -1) {
+            close(keep_open_fd_);
+        }
+    }
+
+    bool open(const std::string& path) {
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0) {
+            if (!S_ISFIFO(info.st_mode)) {
+                std::cerr << "控制管道路径已存在且不是命名管道：" << path << std::endl;
+                return false;
+            }
+        } else if (mkfifo(path.c_str(), 0660) == -1) {
+            std::cerr << "创建控制管道失败：" << path << " - " << strerror(errno) << std::endl;
+            return false;
+        }
+        fd_ = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        // 自己保留一个写端，最后一个写者关闭后管道不会一直报告 EPOLLHUP
+        keep_open_fd_ = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd_ == -1 || keep_open_fd_ == -1) {
+            std::cerr << "打开控制管道失败：" << path << " - " << strerror(errno) << std::endl;
+            return false;
+        }
+        name_ = "fifo:" + path;
+        return true;
+    }
+
+    int fd() const override { return fd_; }
+    const std::string& name() const override { return name_; }
+
+    bool read(std::vector<ControlCommand>& commands) override {
+        char data[512];
+        ssize_t n;
+        while ((n = ::read(fd_, data, sizeof(data))) > 0) {
+            buffer_.append(data, static_cast<size_t>(n));
+        }
+        int64_t now = control_now_us();
+        take_lines(buffer_, [&](const std::string& line) {
+            if (line.find_first_not_of(" \t") == std::string::npos) {
+                return;
+            }
+            ControlCommand command;
+            std::string error;
+            if (parse_control_command(line, now, command, error)) {
+                command.source = name_;
+                commands.push_back(command);
+            } else {
+                std::cerr << name_ << "：" << error << std::endl;
+            }
+        });
+        if (buffer_.size() > MAX_LINE) {
+            buffer_.clear();
+        }
+        return true;
+    }
+
+private:
+    int fd_ = -1;
+    int keep_open_fd_ = -1;
+    std::string name_;
+    std::string buffer_;
+};
+
+// ---------- GPIO 边沿 ----------
+
+class GpioSource : public ControlSource {
+public:
+    GpioSource(int fd, std::string name, ControlCommand command)
+        : fd_(fd), name_(std::move(name)), command_(std::move(command)) {}
+    ~GpioSource() override { close(fd_); }
+
+    int fd() const override { return fd_; }
+    const std::string& name() const override { return name_; }
+
+    bool read(std::vector<ControlCommand>& commands) override {
+        struct gpio_v2_line_event events[16];
+        ssize_t n = ::read(fd_, events, sizeof(events));
+        if (n < 0) {
+            return errno == EINTR || errno == EAGAIN;
+        }
+        for (size_t i = 0; i < static_cast<size_t>(n) / sizeof(events[0]); ++i) {
+            // 没有指定事件时钟时内核时间戳为 CLOCK_MONOTONIC
+            ControlCommand command = command_;
+            command.timestamp_us = static_cast<int64_t>(events[i].timestamp_ns / 1000);
+            command.received_us = command.timestamp_us;
+            commands.push_back(command);
+        }
+        return true;
+    }
+
+private:
+    int fd_;
+    std::string name_;
+    ControlCommand command_;
+};
+
+// ---------- 输入设备按键 ----------
+
+class InputSource : public ControlSource {
+public:
+    InputSource(int fd, int key, std::string name, ControlCommand command)
+        : fd_(fd), key_(key), name_(std::move(name)), command_(std::move(command)) {}
+    ~InputSource() override { close(fd_); }
+
+    int fd() const override { return fd_; }
+    const std::string& name() const override { return name_; }
+
+    bool read(std::vector<ControlCommand>& commands) override {
+        struct input_event events[32];
+        ssize_t n = ::read(fd_, events, sizeof(events));
+        if (n < 0) {
+            // 设备拔出时返回 ENODEV，不再等待这个来源
+            return errno == EINTR || errno == EAGAIN;
+        }
+        for (size_t i = 0; i < static_cast<size_t>(n) / sizeof(events[0]); ++i) {
+            const struct input_event& ev = events[i];
+            if (ev.type != EV_KEY || ev.code != key_ || ev.value != 1) {
+                continue;
+            }
+            ControlCommand command = command_;
+            command.timestamp_us = static_cast<int64_t>(ev.input_event_sec) * 1000000 + ev.input_event_usec;
+            command.received_us = command.timestamp_us;
+            commands.push_back(command);
+        }
+        return true;
+    }
+
+private:
+    int fd_;
+    int key_;
+    std::string name_;
+    ControlCommand command_;
+};
+
+// 设备来源触发的命令，spec 中的命令名不带时间戳
+bool parse_device_command(const std::string& text, const std::string& source, ControlCommand& command) {
+    std::string error;
+    if (!parse_control_command(text, 0, command, error)) {
+        std::cerr << source << "：" << error << std::endl;
+        return false;
+    }
+    command.source = source;
+    return true;
+}
+
+}  // namespace
+
+bool parse_control_command(const std::string& line, int64_t received_us, ControlCommand& command, std::string& error) {
+    std::stringstream in(line);
+    std::vector<std::string> words;
+    std::string word;
+    while (in >> word) {
+        words.push_back(word);
+    }
+    command = ControlCommand();
+    command.timestamp_us = received_us;
+    command.received_us = received_us;
+    if (!words.empty() && words.back()[0] == '@') {
+        char* end = nullptr;
+        command.timestamp_us = std::strtoll(words.back().c_str() + 1, &end, 10);
+        if (*end != '\0' || command.timestamp_us <= 0) {
+            error = "无效的时间戳：" + words.back();
+            return false;
+        }
+        words.pop_back();
+    }
+    if (words.empty()) {
+        error = "空命令";
+        return false;
+    }
+    command.name = words[0];
+    if (command.name == "record" && words.size() == 2 && (words[1] == "start" || words[1] == "stop")) {
+        command.argument = words[1];
+        return true;
+    }
+    if (words.size() > 1) {
+        error = "多余的参数：" + line;
+        return false;
+    }
+    if (command.name != "snapshot" && command.name != "sync" && command.name != "event" && command.name != "record" &&
+        command.name != "stop") {
+        error = "未知的命令：" + command.name;
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<ControlSource> make_stdin_source() {
+    return std::make_unique<StdinSource>();
+}
+
+std::unique_ptr<ControlSource> make_socket_source(const std::string& path) {
+    auto source = std::make_unique<SocketSource>();
+    if (!source->open(path)) {
+        return nullptr;
+    }
+    return source;
+}
+
+std::unique_ptr<ControlSource> make_fifo_source(const std::string& path) {
+    auto source = std::make_unique<FifoSource>();
+    if (!source->open(path)) {
+        return nullptr;
+    }
+    return source;
+}
+
+std::unique_ptr<ControlSource> make_gpio_source(const std::string& spec) {
+    std::vector<std::string> parts = split_spec(spec);
+    if (parts.size() != 4 || (parts[2] != "rising" && parts[2] != "falling" && parts[2] != "both")) {
+        std::cerr << "GPIO 触发应为 芯片:线号:rising|falling|both:命令：" << spec << std::endl;
+        return nullptr;
+    }
+    ControlCommand command;
+    std::string name = "gpio:" + parts[0] + ":" + parts[1];
+    if (!parse_device_command(parts[3], name, command)) {
+        return nullptr;
+    }
+
+    int chip = open(parts[0].c_str(), O_RDONLY | O_CLOEXEC);
+    if (chip == -1) {
+        std::cerr << "打开GPIO芯片失败：" << parts[0] << " - " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    request.offsets[0] = static_cast<uint32_t>(std::atoi(parts[1].c_str()));
+    request.num_lines = 1;
+    strncpy(request.consumer, "multi_camera_capture", sizeof(request.consumer) - 1);
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    if (parts[2] != "falling") {
+        request.config.flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+    }
+    if (parts[2] != "rising") {
+        request.config.flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    }
+    int result = ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &request);
+    int saved_errno = errno;
+    close(chip);
+    if (result == -1) {
+        std::cerr << "申请GPIO线失败：" << name << " - " << strerror(saved_errno) << std::endl;
+        return nullptr;
+    }
+    fcntl(request.fd, F_SETFL, fcntl(request.fd, F_GETFL) | O_NONBLOCK);
+    return std::make_unique<GpioSource>(request.fd, name, command);
+}
+
+std::unique_ptr<ControlSource> make_input_source(const std::string& spec) {
+    std::vector<std::string> parts = split_spec(spec);
+    if (parts.size() != 3) {
+        std::cerr << "输入设备触发应为 设备:按键码:命令：" << spec << std::endl;
+        return nullptr;
+    }
+    ControlCommand command;
+    std::string name = "input:" + parts[0] + ":" + parts[1];
+    if (!parse_device_command(parts[2], name, command)) {
+        return nullptr;
+    }
+
+    int fd = open(parts[0].c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd == -1) {
+        std::cerr << "打开输入设备失败：" << parts[0] << " - " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // 事件时间戳默认为 CLOCK_REALTIME，切换到与帧时间戳相同的时钟
+    int clock = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clock) == -1) {
+        std::cerr << "设置输入设备时钟失败：" << parts[0] << " - " << strerror(errno) << std::endl;
+        close(fd);
+        return nullptr;
+    }
+    return std::make_unique<InputSource>(fd, std::atoi(parts[1].c_str()), name, command);
+}
+
+ControlServer::~ControlServer() {
+    stop();
+}
+
+void ControlServer::add(std::unique_ptr<ControlSource> source) {
+    if (source) {
+        sources_.push_back(std::move(source));
+    }
+}
+
+bool ControlServer::start(Handler handler) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epoll_fd_ == -1 || stop_fd_ == -1) {
+        std::cerr << "创建控制通道失败：" << strerror(errno) << std::endl;
+        return false;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = UINT32_MAX;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &ev);
+    for (size_t i = 0; i < sources_.size(); ++i) {
+        ev.data.u32 = static_cast<uint32_t>(i);
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sources_[i]->fd(), &ev) == -1) {
+            std::cerr << "无法等待控制来源：" << sources_[i]->name() << " - " << strerror(errno) << std::endl;
+        }
+    }
+    handler_ = std::move(handler);
+    thread_ = std::thread(&ControlServer::run, this);
+    return true;
+}
+
+void ControlServer::stop() {
+    if (thread_.joinable()) {
+        uint64_t one = 1;
+        if (write(stop_fd_, &one, sizeof(one)) == -1) {
+            std::cerr << "停止控制通道失败：" << strerror(errno) << std::endl;
+        }
+        thread_.join();
+    }
+    if (epoll_fd_ != -1) {
+        close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    if (stop_fd_ != -1) {
+        close(stop_fd_);
+        stop_fd_ = -1;
+    }
+    sources_.clear();
+}
+
+void ControlServer::run() {
+    std::vector<ControlCommand> commands;
+    struct epoll_event events[16];
+    while (true) {
+        int n = epoll_wait(epoll_fd_, events, 16, -1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "控制通道epoll错误：" << strerror(errno) << std::endl;
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            uint32_t index = events[i].data.u32;
+            if (index == UINT32_MAX) {
+                return;
+            }
+            ControlSource& source = *sources_[index];
+            commands.clear();
+            if (!source.read(commands)) {
+                epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, source.fd(), nullptr);
+                std::cout << "控制来源已结束：" << source.name() << std::endl;
+            }
+            for (const ControlCommand& command : commands) {
+                dispatch_ns_.record((control_now_us() - command.received_us) * 1000);
+                handler_(command);
+            }
+        }
+    }
+}
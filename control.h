@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "disk_writer.h"
+
+// 控制通道：把快照、录制、事件和退出等命令从多个来源汇集到一个分发线程。
+// 分发线程用 epoll 同时等待所有来源，命令到达后立即调用处理函数，不需要终端，
+// 标准输入只是来源之一。
+//
+// 文本命令每行一条（标准输入按单个按键，见 make_stdin_source）：
+//
+//   snapshot                 每个相机保存下一帧
+//   sync                     每个相机保存时间戳最接近命令时刻的一帧
+//   event                    写出触发前后的事件片段
+//   record [start|stop]      开始、停止或切换连续录制
+//   stop                     退出程序
+//
+// 每条命令带 CLOCK_MONOTONIC 时间戳，与驱动帧时间戳是同一个时钟：GPIO 和输入设备取内核
+// 记录的事件时刻，文本命令可以在末尾写 @<微秒> 指定，否则取收到命令的时刻。
+// sync 和 event 按这个时间戳选帧，结果与分发的快慢无关。
+
+struct ControlCommand {
+    std::string name;          // snapshot、sync、event、record、stop
+    std::string argument;      // record 的 start 或 stop，可以为空
+    int64_t timestamp_us = 0;  // 命令对应的时刻
+    int64_t received_us = 0;   // 系统最早看到这条命令的时刻，用于统计分发延迟
+    std::string source;        // 来源描述，用于日志
+};
+
+// 解析一行文本命令，没有 @ 时时间戳取 received_us。失败时返回false并在 error 中给出原因
+bool parse_control_command(const std::string& line, int64_t received_us, ControlCommand& command, std::string& error);
+
+// 命令来源。fd() 可读时分发线程调用 read() 取出就绪的命令
+class ControlSource {
+public:
+    virtual ~ControlSource() = default;
+    virtual int fd() const = 0;
+    // 来源已经结束（例如标准输入到达文件末尾）时返回false，之后不再被调用
+    virtual bool read(std::vector<ControlCommand>& commands) = 0;
+    virtual const std::string& name() const = 0;
+};
+
+// 标准输入的按键：s、t、e、r、q 分别对应 snapshot、sync、event、record、stop
+std::unique_ptr<ControlSource> make_stdin_source();
+// 本地 Unix 流套接字（已存在的同名文件先删除），每个连接可以发送多行命令，
+// 每条命令回复一行 "ok <命令> <时间戳>" 或 "error <原因>"
+std::unique_ptr<ControlSource> make_socket_source(const std::string& path);
+// 命名管道（不存在时创建），写者关闭后继续等待新的写者
+std::unique_ptr<ControlSource> make_fifo_source(const std::string& path);
+// GPIO 线的边沿，通过 gpiochip 字符设备 v2 接口读取内核时间戳。
+// spec 形如 /dev/gpiochip0:17:rising:sync，边沿为 rising、falling 或 both
+std::unique_ptr<ControlSource> make_gpio_source(const std::string& spec);
+// 输入设备（evdev）的按键按下，时间戳切换为 CLOCK_MONOTONIC。
+// spec 形如 /dev/input/event3:28:snapshot，28 为按键码（KEY_ENTER）
+std::unique_ptr<ControlSource> make_input_source(const std::string& spec);
+
+// 命令分发线程。来源在 start 之前添加，创建失败的来源（返回空指针）被忽略
+class ControlServer {
+public:
+    using Handler = std::function<void(const ControlCommand&)>;
+
+    ControlServer() = default;
+    ~ControlServer();
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    void add(std::unique_ptr<ControlSource> source);
+    bool start(Handler handler);
+    void stop();
+
+    // 从 received_us 到开始调用处理函数的时间
+    const LatencyHistogram& dispatch_latency() const { return dispatch_ns_; }
+
+private:
+    void run();
+
+    std::vector<std::unique_ptr<ControlSource>> sources_;
+    Handler handler_;
+    int epoll_fd_ = -1;
+    int stop_fd_ = -1;
+    std::thread thread_;
+    LatencyHistogram dispatch_ns_;
+};
@@ -0,0 +1,595 @@
+#include "disk_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "lockfree_queue.h"
+
+// ---------- 延迟直方图 ----------
+
+int LatencyHistogram::bucket_of(int64_t ns) {
+    if (ns <= 1000) {
+        return 0;
+    }
+    // 以1微秒为起点，每个2倍区间4个桶
+    int bucket = static_cast<int>(std::log2(static_cast<double>(ns) / 1000.0) * 4.0) + 1;
+    return std::min(bucket, NUM_BUCKETS - 1);
+}
+
+int64_t LatencyHistogram::bucket_upper_ns(int bucket) {
+    if (bucket == 0) {
+        return 1000;
+    }
+    return static_cast<int64_t>(1000.0 * std::exp2(bucket / 4.0));
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const auto& b : buckets_) {
+        total += b.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t threshold = static_cast<uint64_t>(std::ceil(total * p / 100.0));
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= threshold) {
+            return bucket_upper_ns(i);
+        }
+    }
+    return bucket_upper_ns(NUM_BUCKETS - 1);
+}
+
+// ---------- 公共部分 ----------
+
+int64_t writer_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+ssize_t pwrite_all(int fd, const uint8_t* data, size_t size, int64_t offset) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = pwrite(fd, data + written, size - written, offset + written);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        written += n;
+    }
+    return static_cast<ssize_t>(written);
+}
+
+WriterFile DiskWriter::open_file(const std::string& path) const {
+    WriterFile file;
+    file.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file.fd == -1) {
+        std::cerr << "无法打开文件：" << path << " - " << strerror(errno) << std::endl;
+        return file;
+    }
+    if (direct_) {
+        file.direct_fd = open(path.c_str(), O_WRONLY | O_DIRECT | O_CLOEXEC);
+        if (file.direct_fd == -1) {
+            std::cerr << "无法以O_DIRECT打开文件，使用普通写：" << path << " - " << strerror(errno) << std::endl;
+        }
+    }
+    return file;
+}
+
+void DiskWriter::close_file(WriterFile& file) {
+    if (file.direct_fd != -1) {
+        close(file.direct_fd);
+        file.direct_fd = -1;
+    }
+    if (file.fd != -1) {
+        close(file.fd);
+        file.fd = -1;
+    }
+}
+
+int DiskWriter::job_fd(const WriteJob& job) const {
+    if (job.file.direct_fd != -1 &&
+        reinterpret_cast<uintptr_t>(job.data) % DIRECT_ALIGNMENT == 0 &&
+        job.size % DIRECT_ALIGNMENT == 0 &&
+        job.offset % DIRECT_ALIGNMENT == 0) {
+        return job.file.direct_fd;
+    }
+    return job.file.fd;
+}
+
+void DiskWriter::thread_started() const {
+    if (thread_start_) {
+        thread_start_();
+    }
+}
+
+void DiskWriter::mark_submitted(WriteJob& job) {
+    job.submit_ns = writer_now_ns();
+    int64_t expected = 0;
+    stats_.first_submit_ns.compare_exchange_strong(expected, job.submit_ns, std::memory_order_relaxed);
+}
+
+void DiskWriter::complete(const WriteJob& job, ssize_t result) {
+    int64_t now = writer_now_ns();
+    stats_.latency.record(now - job.submit_ns);
+    stats_.jobs.fetch_add(1, std::memory_order_relaxed);
+    if (result < 0) {
+        stats_.errors.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        stats_.bytes.fetch_add(result, std::memory_order_relaxed);
+    }
+    int64_t last = stats_.last_complete_ns.load(std::memory_order_relaxed);
+    while (last < now && !stats_.last_complete_ns.compare_exchange_weak(last, now, std::memory_order_relaxed)) {
+    }
+    if (on_complete_) {
+        on_complete_(job, result);
+    }
+}
+
+void DiskWriter::print_stats() const {
+    uint64_t jobs = stats_.jobs.load();
+    uint64_t bytes = stats_.bytes.load();
+    double seconds = (stats_.last_complete_ns.load() - stats_.first_submit_ns.load()) / 1e9;
+    // 按写请求计数：快照的帧头和帧数据分两次写，一帧不一定对应一次写入
+    std::cout << "写盘后端 " << name() << (direct_ ? "（O_DIRECT）" : "") << "：写入 " << jobs << " 次，"
+              << bytes / 1e6 << " MB，错误 " << stats_.errors.load();
+    if (seconds > 0) {
+        std::cout << "，" << bytes / 1e6 / seconds << " MB/s，" << jobs / seconds << " 次写入/s";
+    }
+    std::cout << "，延迟 p50 " << stats_.latency.percentile(50) / 1000
+              << " us，p99 " << stats_.latency.percentile(99) / 1000 << " us" << std::endl;
+}
+
+bool parse_writer_backend(const std::string& name, WriterBackend& backend) {
+    if (name == "sync") {
+        backend = WriterBackend::Sync;
+    } else if (name == "pool") {
+        backend = WriterBackend::Pool;
+    } else if (name == "uring") {
+        backend = WriterBackend::IoUring;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+namespace {
+
+// ---------- 同步后端 ----------
+
+class SyncWriter : public DiskWriter {
+public:
+    SyncWriter(Completion on_complete, bool direct)
+        : DiskWriter(std::move(on_complete), direct) {}
+
+    void submit(WriteJob job) override {
+        mark_submitted(job);
+        complete(job, pwrite_all(job_fd(job), job.data, job.size, job.offset));
+    }
+
+    void drain() override {}
+    const char* name() const override { return "sync"; }
+};
+
+// ---------- 写线程池后端 ----------
+
+class PoolWriter : public DiskWriter {
+public:
+    static constexpr size_t QUEUE_CAPACITY = 64;
+
+    PoolWriter(int threads, Completion on_complete, bool direct, ThreadStart thread_start)
+        : DiskWriter(std::move(on_complete), direct, std::move(thread_start)), workers_(std::max(1, threads)) {
+        for (auto& w : workers_) {
+            w.queue.init(QUEUE_CAPACITY);
+        }
+        for (auto& w : workers_) {
+            w.thread = std::thread(&PoolWriter::run, this, &w);
+        }
+    }
+
+    ~PoolWriter() override {
+        drain();
+        stop_ = true;
+        for (auto& w : workers_) {
+            w.waker.notify();
+            w.thread.join();
+        }
+    }
+
+    // 轮流分配给各写线程，目标队列满时尝试下一个
+    void submit(WriteJob job) override {
+        mark_submitted(job);
+        in_flight_.fetch_add(1);
+        size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        while (true) {
+            for (size_t i = 0; i < workers_.size(); ++i) {
+                Worker& w = workers_[(start + i) % workers_.size()];
+                if (w.queue.try_push(std::move(job))) {
+                    w.waker.notify();
+                    return;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void drain() override {
+        for (int n = in_flight_.load(); n != 0; n = in_flight_.load()) {
+            in_flight_.wait(n);
+        }
+    }
+
+    const char* name() const override { return "pool"; }
+
+private:
+    struct Worker {
+        LockFreeQueue<WriteJob> queue;
+        QueueWaker waker;
+        std::thread thread;
+    };
+
+    void run(Worker* w) {
+        thread_started();
+        while (true) {
+            WriteJob job;
+            if (!w->queue.try_pop(job)) {
+                if (stop_.load()) {
+                    return;
+                }
+                w->waker.wait([w, this] { return !w->queue.empty_approx() || stop_.load(); });
+                continue;
+            }
+            complete(job, pwrite_all(job_fd(job), job.data, job.size, job.offset));
+            in_flight_.fetch_sub(1);
+            in_flight_.notify_all();
+        }
+    }
+
+    std::vector<Worker> workers_;
+    std::atomic<size_t> next_{0};
+    std::atomic<int> in_flight_{0};
+    std::atomic<bool> stop_{false};
+};
+
+// ---------- io_uring 后端 ----------
+
+int sys_io_uring_setup(unsigned entries, struct io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+// 直接使用内核接口（不依赖liburing）的io_uring写后端。
+// 一个提交线程从队列批量取请求填入SQ，一次 io_uring_enter 提交整批并收割完成事件。
+// io_uring_enter 出现无法重试的错误后改用 pwrite：还在SQ中的请求和之后的请求由提交线程同步写，
+// 已提交的请求等内核完成，每个请求都会调用完成回调，drain 不会一直等待
+class IoUringWriter : public DiskWriter {
+public:
+    static constexpr unsigned RING_ENTRIES = 64;
+
+    IoUringWriter(Completion on_complete, bool direct, ThreadStart thread_start)
+        : DiskWriter(std::move(on_complete), direct, std::move(thread_start)) {}
+
+    ~IoUringWriter() override {
+        if (thread_.joinable()) {
+            drain();
+            stop_ = true;
+            waker_.notify();
+            thread_.join();
+        }
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+        if (cq_ptr_ != nullptr && cq_ptr_ != sq_ptr_) {
+            munmap(cq_ptr_, cq_size_);
+        }
+        if (sq_ptr_ != nullptr) {
+            munmap(sq_ptr_, sq_size_);
+        }
+        if (ring_fd_ != -1) {
+            close(ring_fd_);
+        }
+    }
+
+    // 建立环形队列并启动提交线程，内核不支持时返回false
+    bool start() {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring_fd_ = sys_io_uring_setup(RING_ENTRIES, &params);
+        if (ring_fd_ == -1) {
+            std::cerr << "io_uring不可用：" << strerror(errno) << std::endl;
+            return false;
+        }
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        }
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) {
+            sq_ptr_ = nullptr;
+            return false;
+        }
+        if (single_mmap) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) {
+                cq_ptr_ = nullptr;
+                return false;
+            }
+        }
+        sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+        sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+        sq_entries_ = params.sq_entries;
+
+        slots_.resize(sq_entries_);
+        for (unsigned i = 0; i < sq_entries_; ++i) {
+            free_slots_.push_back(sq_entries_ - 1 - i);
+        }
+        queue_.init(RING_ENTRIES * 2);
+        thread_ = std::thread(&IoUringWriter::run, this);
+        return true;
+    }
+
+    void submit(WriteJob job) override {
+        mark_submitted(job);
+        in_flight_.fetch_add(1);
+        while (!queue_.try_push(std::move(job))) {
+            std::this_thread::yield();
+        }
+        waker_.notify();
+    }
+
+    void drain() override {
+        for (int n = in_flight_.load(); n != 0; n = in_flight_.load()) {
+            in_flight_.wait(n);
+        }
+    }
+
+    const char* name() const override { return "uring"; }
+
+private:
+    // 把请求（或部分写后剩余的部分）放入SQ，不立即提交
+    void prepare(unsigned slot) {
+        const WriteJob& job = slots_[slot].job;
+        size_t done = slots_[slot].done;
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & sq_mask_;
+        struct io_uring_sqe* sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = job_fd(job);
+        sqe->addr = reinterpret_cast<uint64_t>(job.data + done);
+        sqe->len = static_cast<uint32_t>(job.size - done);
+        sqe->off = job.offset + done;
+        sqe->user_data = slot;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++pending_submit_;
+    }
+
+    // 收割所有完成事件，返回处理的数量
+    unsigned reap() {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        unsigned reaped = 0;
+        while (head != tail) {
+            struct io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+            unsigned slot = static_cast<unsigned>(cqe->user_data);
+            int res = cqe->res;
+            ++head;
+            ++reaped;
+            --submitted_;
+
+            Slot& s = slots_[slot];
+            if (res > 0 && s.done + res < s.job.size) {
+                // 部分写，继续写剩余部分
+                s.done += res;
+                if (failed_) {
+                    write_sync(slot);
+                } else {
+                    prepare(slot);
+                }
+                continue;
+            }
+            finish_slot(slot, res < 0 ? res : static_cast<ssize_t>(s.done + res));
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return reaped;
+    }
+
+    void finish_slot(unsigned slot, ssize_t result) {
+        WriteJob job = slots_[slot].job;
+        free_slots_.push_back(slot);
+        finish_job(job, result);
+    }
+
+    void finish_job(const WriteJob& job, ssize_t result) {
+        complete(job, result);
+        in_flight_.fetch_sub(1);
+        in_flight_.notify_all();
+    }
+
+    // 用 pwrite 写完槽中请求的剩余部分
+    void write_sync(unsigned slot) {
+        Slot& s = slots_[slot];
+        ssize_t res = pwrite_all(job_fd(s.job), s.job.data + s.done, s.job.size - s.done, s.job.offset + s.done);
+        finish_slot(slot, res < 0 ? res : static_cast<ssize_t>(s.done + res));
+    }
+
+    // io_uring_enter 无法重试时调用：撤回还在SQ中、内核没有取走的请求，改用 pwrite 写
+    void fall_back(int error) {
+        std::cerr << "io_uring提交失败：" << strerror(error) << "，改用 pwrite 写盘" << std::endl;
+        failed_ = true;
+        unsigned tail = *sq_tail_ - pending_submit_;
+        __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+        for (unsigned i = 0; i < pending_submit_; ++i) {
+            write_sync(static_cast<unsigned>(sqes_[(tail + i) & sq_mask_].user_data));
+        }
+        pending_submit_ = 0;
+    }
+
+    // 退回 pwrite 之后的主循环：新请求同步写，已提交的请求只收割，返回false时线程退出
+    bool serve_fallback() {
+        WriteJob job;
+        if (queue_.try_pop(job)) {
+            finish_job(job, pwrite_all(job_fd(job), job.data, job.size, job.offset));
+            return true;
+        }
+        if (submitted_ > 0) {
+            // 内核完成后照常写入CQ，不需要 io_uring_enter
+            if (reap() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+        if (stop_.load() && queue_.empty_approx()) {
+            return false;
+        }
+        waker_.wait([this] { return !queue_.empty_approx() || stop_.load(); });
+        return true;
+    }
+
+    void run() {
+        thread_started();
+        while (true) {
+            if (failed_) {
+                if (!serve_fallback()) {
+                    return;
+                }
+                continue;
+            }
+
+            // 从队列批量取出请求填满SQ
+            WriteJob job;
+            while (!free_slots_.empty() && queue_.try_pop(job)) {
+                unsigned slot = free_slots_.back();
+                free_slots_.pop_back();
+                slots_[slot].job = job;
+                slots_[slot].done = 0;
+                prepare(slot);
+            }
+
+            if (pending_submit_ == 0 && submitted_ == 0) {
+                if (stop_.load() && queue_.empty_approx()) {
+                    return;
+                }
+                waker_.wait([this] { return !queue_.empty_approx() || stop_.load(); });
+                continue;
+            }
+
+            // 提交整批；没有新请求可取时等待至少一个完成事件
+            bool wait = free_slots_.empty() || queue_.empty_approx();
+            unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+            int ret = sys_io_uring_enter(ring_fd_, pending_submit_, wait ? 1 : 0, flags);
+            if (ret < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    reap();
+                    continue;
+                }
+                fall_back(errno);
+                continue;
+            }
+            submitted_ += ret;
+            pending_submit_ -= ret;
+            reap();
+        }
+    }
+
+    struct Slot {
+        WriteJob job;
+        size_t done = 0;
+    };
+
+    int ring_fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+    struct io_uring_sqe* sqes_ = nullptr;
+    struct io_uring_cqe* cqes_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned cq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+
+    // 以下只由提交线程访问
+    std::vector<Slot> slots_;
+    std::vector<unsigned> free_slots_;
+    unsigned pending_submit_ = 0;  // 已放入SQ但尚未提交
+    unsigned submitted_ = 0;       // 已提交尚未完成
+    bool failed_ = false;          // io_uring 出错，已改用 pwrite
+
+    LockFreeQueue<WriteJob> queue_;
+    QueueWaker waker_;
+    std::thread thread_;
+    std::atomic<int> in_flight_{0};
+    std::atomic<bool> stop_{false};
+};
+
+}  // namespace
+
+std::unique_ptr<DiskWriter> create_disk_writer(WriterBackend backend, int threads, bool direct,
+                                               DiskWriter::Completion on_complete,
+                                               DiskWriter::ThreadStart thread_start) {
+    switch (backend) {
+    case WriterBackend::Sync:
+        return std::make_unique<SyncWriter>(std::move(on_complete), direct);
+    case WriterBackend::IoUring: {
+        auto writer = std::make_unique<IoUringWriter>(on_complete, direct, thread_start);
+        if (writer->start()) {
+            return writer;
+        }
+        std::cerr << "退回写线程池后端" << std::endl;
+        break;
+    }
+    case WriterBackend::Pool:
+        break;
+    }
+    return std::make_unique<PoolWriter>(threads, std::move(on_complete), direct, std::move(thread_start));
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+// 对数刻度的延迟直方图（每个2倍区间分4个桶），只用relaxed原子操作，可在多线程中记录
+class LatencyHistogram {
+public:
+    static constexpr int NUM_BUCKETS = 128;
+
+    void record(int64_t ns) {
+        buckets_[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    // 返回百分位数（0~100）对应桶的上限，单位纳秒
+    int64_t percentile(double p) const;
+    uint64_t count() const;
+    int64_t sum_ns() const { return sum_ns_.load(std::memory_order_relaxed); }
+
+    // 单个桶的样本数和上限，用于导出
+    uint64_t bucket(int i) const { return buckets_[i].load(std::memory_order_relaxed); }
+    static int64_t bucket_upper_ns(int bucket);
+
+private:
+    static int bucket_of(int64_t ns);
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_{};
+    std::atomic<int64_t> sum_ns_{0};
+};
+
+// 写盘后端的统计
+struct WriterStats {
+    std::atomic<uint64_t> jobs{0};  // 完成的写请求数，不是帧数
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<int64_t> first_submit_ns{0};
+    std::atomic<int64_t> last_complete_ns{0};
+    LatencyHistogram latency;  // 提交到完成的延迟
+};
+
+// 输出文件。O_DIRECT 模式下另外打开一个直写描述符，
+// 地址、长度和偏移都按块对齐的写走 direct_fd，其余走普通 fd
+struct WriterFile {
+    int fd = -1;
+    int direct_fd = -1;
+};
+
+// 一次写盘请求，偏移由调用者决定，所以同一文件的写可以乱序完成
+struct WriteJob {
+    WriterFile file;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    int64_t offset = 0;
+    uint64_t tag = 0;        // 由调用者解释，完成回调中原样返回
+    int64_t submit_ns = 0;
+};
+
+enum class WriterBackend {
+    Sync,     // 在提交线程中直接 pwrite
+    Pool,     // 写线程池
+    IoUring,  // io_uring 批量提交
+};
+
+// 写盘后端接口。完成回调在写线程（或同步后端的提交线程）中调用，
+// result 为写入的字节数，失败时为 -errno
+class DiskWriter {
+public:
+    using Completion = std::function<void(const WriteJob& job, ssize_t result)>;
+    // 写线程启动后首先调用，用于设置线程名称和CPU绑定
+    using ThreadStart = std::function<void()>;
+
+    static constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+    virtual ~DiskWriter() = default;
+
+    // 提交写请求，队列满时阻塞直到有空位
+    virtual void submit(WriteJob job) = 0;
+    // 等待所有已提交的请求完成
+    virtual void drain() = 0;
+    virtual const char* name() const = 0;
+
+    // 打开/关闭输出文件，关闭前调用者需保证该文件没有未完成的写
+    WriterFile open_file(const std::string& path) const;
+    static void close_file(WriterFile& file);
+
+    bool direct() const { return direct_; }
+    const WriterStats& stats() const { return stats_; }
+
+    // 输出吞吐量、帧率和延迟百分位
+    void print_stats() const;
+
+protected:
+    DiskWriter(Completion on_complete, bool direct, ThreadStart thread_start = nullptr)
+        : on_complete_(std::move(on_complete)), thread_start_(std::move(thread_start)), direct_(direct) {}
+
+    // 选择该请求使用的文件描述符
+    int job_fd(const WriteJob& job) const;
+    void mark_submitted(WriteJob& job);
+    void complete(const WriteJob& job, ssize_t result);
+
+    void thread_started() const;
+
+    Completion on_complete_;
+    ThreadStart thread_start_;
+    bool direct_;
+    WriterStats stats_;
+};
+
+// 写满整个缓冲区，处理部分写和EINTR，返回写入的字节数或 -errno
+ssize_t pwrite_all(int fd, const uint8_t* data, size_t size, int64_t offset);
+
+int64_t writer_now_ns();
+
+// 按名称解析后端（sync、pool、uring），无法识别时返回false
+bool parse_writer_backend(const std::string& name, WriterBackend& backend);
+
+// 创建写盘后端。io_uring 不可用时退回写线程池。
+// thread_start 在后端自己的每个写线程中调用一次，同步后端没有写线程，不调用
+std::unique_ptr<DiskWriter> create_disk_writer(WriterBackend backend, int threads, bool direct,
+                                               DiskWriter::Completion on_complete,
+                                               DiskWriter::ThreadStart thread_start = nullptr);
@@ -0,0 +1,328 @@
+#include "frame_container.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ContainerWriter::ContainerWriter(DiskWriter* writer, std::string path_prefix, uint64_t segment_bytes)
+    : writer_(writer),
+      path_prefix_(std::move(path_prefix)),
+      segment_bytes_(segment_bytes),
+      alignment_(alignment_for(writer->direct())) {}
+
+ContainerWriter::~ContainerWriter() {
+    close();
+}
+
+bool ContainerWriter::open_segment() {
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%03u", segment_index_);
+    file_path_ = path_prefix_ + suffix + CONTAINER_EXTENSION;
+    file_ = writer_->open_file(file_path_);
+    if (file_.fd == -1) {
+        return false;
+    }
+
+    // 分段头占一个对齐块，同步写入
+    std::vector<uint8_t> block(header_block(), 0);
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+    header.version = CONTAINER_VERSION;
+    header.header_size = static_cast<uint32_t>(block.size());
+    header.alignment = static_cast<uint32_t>(alignment_);
+    header.segment_index = segment_index_;
+    header.created_unix = std::time(nullptr);
+    memcpy(block.data(), &header, sizeof(header));
+    if (pwrite_all(file_.fd, block.data(), block.size(), 0) < 0) {
+        std::cerr << "写入分段头失败：" << file_path_ << " - " << strerror(errno) << std::endl;
+        DiskWriter::close_file(file_);
+        return false;
+    }
+
+    offset_ = static_cast<int64_t>(block.size());
+    index_.clear();
+    return true;
+}
+
+void ContainerWriter::finish_segment() {
+    if (file_.fd == -1) {
+        return;
+    }
+    // 帧数据全部落盘后再写索引，保证索引指向的内容有效
+    writer_->drain();
+
+    IndexFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.index_offset = static_cast<uint64_t>(offset_);
+    footer.entry_count = index_.size();
+    memcpy(footer.magic, INDEX_MAGIC, sizeof(footer.magic));
+
+    size_t index_bytes = index_.size() * sizeof(IndexEntry);
+    if (pwrite_all(file_.fd, reinterpret_cast<const uint8_t*>(index_.data()), index_bytes, offset_) < 0 ||
+        pwrite_all(file_.fd, reinterpret_cast<const uint8_t*>(&footer), sizeof(footer), offset_ + index_bytes) < 0) {
+        std::cerr << "写入索引失败：" << file_path_ << std::endl;
+    }
+    DiskWriter::close_file(file_);
+    index_.clear();
+    ++segment_index_;
+}
+
+bool ContainerWriter::append(const FrameMeta& meta, uint8_t* header_buf, FramePlacement& placement) {
+    uint64_t entry_size = header_block() + padded_payload(meta.payload_size);
+
+    // 当前分段已有帧且放不下这一帧时切换分段
+    if (file_.fd != -1 && !index_.empty() && offset_ + entry_size > segment_bytes_) {
+        finish_segment();
+    }
+    if (file_.fd == -1 && !open_segment()) {
+        return false;
+    }
+
+    FrameHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FRAME_MAGIC;
+    header.header_size = sizeof(FrameHeader);
+    header.camera_id = static_cast<uint16_t>(meta.camera_id);
+    header.pixelformat = meta.pixelformat;
+    header.width = meta.width;
+    header.height = meta.height;
+    header.bytesperline = meta.bytesperline;
+    header.sequence = meta.sequence;
+    header.timestamp_us = meta.timestamp_us;
+    header.payload_size = meta.payload_size;
+    header.entry_size = entry_size;
+    header.payload_offset = static_cast<uint32_t>(header_block());
+    memset(header_buf, 0, header_block());
+    memcpy(header_buf, &header, sizeof(header));
+
+    IndexEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = static_cast<uint64_t>(offset_);
+    entry.timestamp_us = meta.timestamp_us;
+    entry.sequence = meta.sequence;
+    entry.camera_id = static_cast<uint16_t>(meta.camera_id);
+    index_.push_back(entry);
+
+    placement.file = file_;
+    placement.offset = offset_;
+    placement.entry_size = entry_size;
+    offset_ += static_cast<int64_t>(entry_size);
+    return true;
+}
+
+void ContainerWriter::close() {
+    finish_segment();
+}
+
+ContainerReader::~ContainerReader() {
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+}
+
+bool ContainerReader::open(const std::string& path, std::string& error) {
+    path_ = path;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        error = strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        error = strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ < sizeof(SegmentHeader)) {
+        error = "文件太小";
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        error = strerror(errno);
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(data);
+
+    SegmentHeader header;
+    memcpy(&header, data_, sizeof(header));
+    if (memcmp(header.magic, SEGMENT_MAGIC, sizeof(header.magic)) != 0 || header.version != CONTAINER_VERSION ||
+        header.header_size < sizeof(SegmentHeader) || header.header_size > size_) {
+        error = "不是有效的容器分段";
+        return false;
+    }
+    first_frame_ = header.header_size;
+
+    if (!load_index()) {
+        scan_frames();
+    }
+    return true;
+}
+
+bool ContainerReader::load_index() {
+    if (size_ < first_frame_ + sizeof(IndexFooter)) {
+        return false;
+    }
+    IndexFooter footer;
+    memcpy(&footer, data_ + size_ - sizeof(footer), sizeof(footer));
+    // 逐项比较剩余长度，伪造的偏移和项数不会相加溢出，也不会按伪造的项数分配内存
+    if (memcmp(footer.magic, INDEX_MAGIC, sizeof(footer.magic)) != 0 ||
+        footer.index_offset > size_ - sizeof(footer) ||
+        footer.entry_count > (size_ - sizeof(footer) - footer.index_offset) / sizeof(IndexEntry)) {
+        return false;
+    }
+
+    offsets_.clear();
+    offsets_.reserve(footer.entry_count);
+    for (uint64_t i = 0; i < footer.entry_count; ++i) {
+        IndexEntry entry;
+        memcpy(&entry, data_ + footer.index_offset + i * sizeof(IndexEntry), sizeof(entry));
+        if (!frame_valid(entry.offset, footer.index_offset)) {
+            return false;
+        }
+        offsets_.push_back(entry.offset);
+    }
+    return true;
+}
+
+void ContainerReader::scan_frames() {
+    offsets_.clear();
+    uint64_t offset = first_frame_;
+    while (offset + sizeof(FrameHeader) <= size_) {
+        // 帧头无效或帧数据不完整时停止，之后的内容是未写完的部分
+        if (!frame_valid(offset, size_)) {
+            break;
+        }
+        offsets_.push_back(offset);
+        offset += reinterpret_cast<const FrameHeader*>(data_ + offset)->entry_size;
+    }
+}
+
+bool ContainerReader::frame_valid(uint64_t offset, uint64_t end) const {
+    if (offset < first_frame_ || end > size_ || offset > end || end - offset < sizeof(FrameHeader)) {
+        return false;
+    }
+    const FrameHeader* header = reinterpret_cast<const FrameHeader*>(data_ + offset);
+    // 逐项比较剩余长度，避免伪造的大数值相加溢出
+    return header->magic == FRAME_MAGIC && header->payload_offset >= sizeof(FrameHeader) &&
+           header->entry_size >= header->payload_offset &&
+           header->payload_size <= header->entry_size - header->payload_offset &&
+           header->payload_offset <= end - offset &&
+           header->payload_size <= end - offset - header->payload_offset;
+}
+
+FrameView ContainerReader::frame(size_t i) const {
+    FrameView view;
+    view.header = reinterpret_cast<const FrameHeader*>(data_ + offsets_[i]);
+    view.payload = data_ + offsets_[i] + view.header->payload_offset;
+    return view;
+}
+
+namespace {
+
+bool ends_with(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// 分段文件名去掉 "_NNN.frames" 后的录制前缀，不是分段文件名时返回空
+std::string segment_prefix(const std::string& name) {
+    std::string extension = CONTAINER_EXTENSION;
+    if (!ends_with(name, extension)) {
+        return {};
+    }
+    size_t end = name.size() - extension.size();
+    size_t underscore = name.rfind('_', end);
+    if (underscore == std::string::npos || underscore + 1 == end ||
+        name.find_first_not_of("0123456789", underscore + 1) < end) {
+        return {};
+    }
+    return name.substr(0, underscore);
+}
+
+}  // namespace
+
+bool recording_segments(const std::string& path, std::vector<std::string>& segments, std::string& error) {
+    segments.clear();
+    std::string prefix = path;
+    struct stat st;
+    bool exists = stat(path.c_str(), &st) == 0;
+    if (exists && S_ISREG(st.st_mode)) {
+        segments.push_back(path);
+        return true;
+    }
+    if (exists && S_ISDIR(st.st_mode)) {
+        DIR* dir = opendir(path.c_str());
+        if (dir == nullptr) {
+            error = strerror(errno);
+            return false;
+        }
+        std::string found;
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = segment_prefix(entry->d_name);
+            if (name.empty() || name == found) {
+                continue;
+            }
+            if (!found.empty()) {
+                error = "目录中有多次录制（" + found + "、" + name + "），请指定其中一个的路径前缀";
+                closedir(dir);
+                return false;
+            }
+            found = name;
+        }
+        closedir(dir);
+        if (found.empty()) {
+            error = "目录中没有容器分段";
+            return false;
+        }
+        prefix = path + "/" + found;
+    }
+
+    for (uint32_t index = 0;; ++index) {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), "_%03u", index);
+        std::string segment = prefix + suffix + CONTAINER_EXTENSION;
+        if (stat(segment.c_str(), &st) != 0) {
+            break;
+        }
+        segments.push_back(segment);
+    }
+    if (segments.empty()) {
+        error = "找不到分段 " + prefix + "_000" + CONTAINER_EXTENSION;
+        return false;
+    }
+    return true;
+}
+
+bool RecordingReader::open(const std::string& path, std::string& error) {
+    segments_.clear();
+    frames_.clear();
+    std::vector<std::string> paths;
+    if (!recording_segments(path, paths, error)) {
+        return false;
+    }
+    for (const std::string& segment_path : paths) {
+        auto segment = std::make_unique<ContainerReader>();
+        if (!segment->open(segment_path, error)) {
+            error = segment_path + "：" + error;
+            segments_.clear();
+            frames_.clear();
+            return false;
+        }
+        for (size_t i = 0; i < segment->frame_count(); ++i) {
+            frames_.push_back(FrameRef{static_cast<uint32_t>(segments_.size()), static_cast<uint32_t>(i)});
+        }
+        segments_.push_back(std::move(segment));
+    }
+    return true;
+}
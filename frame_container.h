@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "disk_writer.h"
+
+// 分段、只追加的帧容器格式（.frames）。每个分段文件的布局：
+//
+//   [分段头块] [帧头块 | 帧数据 | 填充] [帧头块 | 帧数据 | 填充] ... [索引] [索引尾]
+//
+// 所有块都按分段头中记录的 alignment 对齐（普通写为64字节，O_DIRECT 为4096字节），
+// 因此帧可以用一次大块顺序写落盘。索引尾固定在文件末尾；
+// 程序异常退出导致没有索引时，可以沿帧头中的 entry_size 顺序扫描恢复。
+// 所有整数均为小端序。
+
+constexpr char SEGMENT_MAGIC[8] = {'M', 'C', 'F', 'R', 'S', 'E', 'G', '1'};
+constexpr char INDEX_MAGIC[8] = {'M', 'C', 'F', 'R', 'I', 'D', 'X', '1'};
+constexpr uint32_t FRAME_MAGIC = 0x5246434d;  // "MCFR"
+constexpr uint32_t CONTAINER_VERSION = 1;
+constexpr const char* CONTAINER_EXTENSION = ".frames";
+
+// 分段头，位于文件开头
+struct SegmentHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;     // 分段头块大小，第一帧从这里开始
+    uint32_t alignment;
+    uint32_t segment_index;
+    int64_t created_unix;     // 创建时间（秒）
+    uint8_t reserved[32];
+};
+static_assert(sizeof(SegmentHeader) == 64, "SegmentHeader 必须为64字节");
+
+// 帧头，位于每帧所在块的开头
+struct FrameHeader {
+    uint32_t magic;           // FRAME_MAGIC
+    uint16_t header_size;     // sizeof(FrameHeader)
+    uint16_t camera_id;
+    uint32_t pixelformat;     // V4L2 fourcc
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesperline;
+    uint32_t sequence;        // v4l2_buffer.sequence
+    uint32_t flags;
+    int64_t timestamp_us;     // v4l2_buffer.timestamp（CLOCK_MONOTONIC）
+    uint64_t payload_size;    // 帧数据字节数
+    uint64_t entry_size;      // 帧头块 + 帧数据 + 填充，下一帧位于 offset + entry_size
+    uint32_t payload_offset;  // 帧数据相对帧头的偏移（即帧头块大小）
+    uint32_t reserved;
+};
+static_assert(sizeof(FrameHeader) == 64, "FrameHeader 必须为64字节");
+
+// 索引项，每帧一项
+struct IndexEntry {
+    uint64_t offset;          // 帧头在分段中的偏移
+    int64_t timestamp_us;
+    uint32_t sequence;
+    uint16_t camera_id;
+    uint16_t reserved;
+};
+static_assert(sizeof(IndexEntry) == 24, "IndexEntry 必须为24字节");
+
+// 索引尾，位于文件最后32字节
+struct IndexFooter {
+    uint64_t index_offset;
+    uint64_t entry_count;
+    char magic[8];
+    uint64_t reserved;
+};
+static_assert(sizeof(IndexFooter) == 32, "IndexFooter 必须为32字节");
+
+// 写入一帧所需的元数据
+struct FrameMeta {
+    int camera_id = 0;
+    uint32_t sequence = 0;
+    int64_t timestamp_us = 0;
+    uint32_t pixelformat = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t bytesperline = 0;
+    uint64_t payload_size = 0;
+};
+
+// 帧在分段中的位置，调用者据此向写盘后端提交帧头块和帧数据
+struct FramePlacement {
+    WriterFile file;
+    int64_t offset = 0;        // 帧头块的偏移
+    uint64_t entry_size = 0;
+};
+
+inline size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// 容器写入器，只能在一个线程中使用。帧数据通过 DiskWriter 异步写入，
+// 切换分段和关闭时先等待写盘后端完成，再同步写入索引
+class ContainerWriter {
+public:
+    // path_prefix 例如 "data/record_1700000000"，分段文件名为 <prefix>_<序号>.frames
+    ContainerWriter(DiskWriter* writer, std::string path_prefix, uint64_t segment_bytes);
+    ~ContainerWriter();
+    ContainerWriter(const ContainerWriter&) = delete;
+    ContainerWriter& operator=(const ContainerWriter&) = delete;
+
+    // 写盘后端是否使用 O_DIRECT 决定容器的对齐
+    static size_t alignment_for(bool direct) { return direct ? DiskWriter::DIRECT_ALIGNMENT : 64; }
+
+    size_t alignment() const { return alignment_; }
+    // 当前分段的文件路径
+    const std::string& path() const { return file_path_; }
+    // 帧头块大小，帧数据紧跟其后
+    size_t header_block() const { return align_up(sizeof(FrameHeader), alignment_); }
+    // 帧数据写入时的长度（按对齐向上取整）
+    size_t padded_payload(size_t payload_size) const { return align_up(payload_size, alignment_); }
+
+    // 为一帧分配位置并在 header_buf（至少 header_block() 字节）中填写帧头，
+    // 当前分段放不下时先切换到新分段。失败时返回false
+    bool append(const FrameMeta& meta, uint8_t* header_buf, FramePlacement& placement);
+
+    // 写完当前分段的索引并关闭文件
+    void close();
+
+private:
+    bool open_segment();
+    void finish_segment();
+
+    DiskWriter* writer_;
+    std::string path_prefix_;
+    uint64_t segment_bytes_;
+    size_t alignment_;
+
+    WriterFile file_;
+    std::string file_path_;
+    uint32_t segment_index_ = 0;
+    int64_t offset_ = 0;
+    std::vector<IndexEntry> index_;
+};
+
+// 容器中的一帧，指针指向只读映射的文件内容，在读取器销毁前有效
+struct FrameView {
+    const FrameHeader* header = nullptr;
+    const uint8_t* payload = nullptr;
+};
+
+// 以只读内存映射方式读取一个容器分段，帧数据不复制。
+// 优先使用文件末尾的索引，没有索引（写入时异常退出）时顺序扫描帧头
+class ContainerReader {
+public:
+    ContainerReader() = default;
+    ~ContainerReader();
+    ContainerReader(const ContainerReader&) = delete;
+    ContainerReader& operator=(const ContainerReader&) = delete;
+
+    // 打开并校验分段文件，失败时返回false并在 error 中给出原因
+    bool open(const std::string& path, std::string& error);
+
+    size_t frame_count() const { return offsets_.size(); }
+    FrameView frame(size_t i) const;
+    const std::string& path() const { return path_; }
+
+private:
+    bool load_index();
+    void scan_frames();
+    // offset 处的帧头有效，且帧数据在帧的条目之内、在 end 之前结束
+    bool frame_valid(uint64_t offset, uint64_t end) const;
+
+    std::string path_;
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t first_frame_ = 0;
+    std::vector<uint64_t> offsets_;
+};
+
+// 一次录制的全部分段：path 为分段文件时只有这个分段；为录制的路径前缀（例如 "data/record_1700000000"）时
+// 依次为 <prefix>_000.frames、<prefix>_001.frames ……直到缺少的序号；为目录时取目录中的录制，
+// 目录中有多次录制时要求指定前缀。找不到分段时返回false并在 error 中给出原因
+bool recording_segments(const std::string& path, std::vector<std::string>& segments, std::string& error);
+
+// 按顺序拼接读取一次录制的所有分段，帧编号跨分段连续
+class RecordingReader {
+public:
+    // path 的含义见 recording_segments，任何一个分段打不开时返回false
+    bool open(const std::string& path, std::string& error);
+
+    size_t frame_count() const { return frames_.size(); }
+    FrameView frame(size_t i) const { return segments_[frames_[i].segment]->frame(frames_[i].index); }
+    size_t segment_count() const { return segments_.size(); }
+
+private:
+    struct FrameRef {
+        uint32_t segment;
+        uint32_t index;
+    };
+
+    std::vector<std::unique_ptr<ContainerReader>> segments_;
+    std::vector<FrameRef> frames_;
+};
@@ -0,0 +1,185 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <linux/videodev2.h>
+#include <opencv2/opencv.hpp>
+
+#include "frame_container.h"
+
+// 把 data 目录中的帧容器批量转换为 JPEG/PNG。
+// 容器以内存映射方式读取，所有帧分给多个线程并行转换，宽高和格式取自帧头。
+// MJPEG 帧输出JPEG时直接写出原始数据
+
+// 一个待转换的帧
+struct ConvertTask {
+    const ContainerReader* reader;
+    size_t index;
+};
+
+// 列出目录中所有容器分段，按文件名排序
+std::vector<std::string> list_containers(const std::string& folder) {
+    std::vector<std::string> paths;
+    DIR* dir = opendir(folder.c_str());
+    if (dir == nullptr) {
+        std::cerr << "无法打开目录：" << folder << " - " << strerror(errno) << std::endl;
+        return paths;
+    }
+    std::string extension = CONTAINER_EXTENSION;
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0) {
+            paths.push_back(folder + "/" + name);
+        }
+    }
+    closedir(dir);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+// 转换一帧并写出图像文件，失败时返回false
+bool convert_frame(const FrameView& frame, const std::string& output_folder, const std::string& extension,
+                   const std::vector<int>& params) {
+    const FrameHeader& h = *frame.header;
+    std::string filename = output_folder + "/camera_" + std::to_string(h.camera_id) + "_" +
+                           std::to_string(h.sequence) + "_" + std::to_string(h.timestamp_us) + extension;
+
+    if (h.pixelformat == V4L2_PIX_FMT_MJPEG) {
+        // 输出JPEG时压缩数据原样写出，不解码也不重新压缩
+        if (extension == ".jpg") {
+            FILE* file = fopen(filename.c_str(), "wb");
+            bool ok = file != nullptr && fwrite(frame.payload, 1, h.payload_size, file) == h.payload_size;
+            if (file != nullptr && fclose(file) != 0) {
+                ok = false;
+            }
+            if (!ok) {
+                std::cerr << "写入失败：" << filename << " - " << strerror(errno) << std::endl;
+            }
+            return ok;
+        }
+        cv::Mat jpeg(1, static_cast<int>(h.payload_size), CV_8UC1, const_cast<uint8_t*>(frame.payload));
+        cv::Mat bgr = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+        if (bgr.empty()) {
+            std::cerr << "解码失败：相机 " << h.camera_id << " 帧 " << h.sequence << std::endl;
+            return false;
+        }
+        if (!cv::imwrite(filename, bgr, params)) {
+            std::cerr << "写入失败：" << filename << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if (h.pixelformat != V4L2_PIX_FMT_YUYV) {
+        std::cerr << "跳过不支持的像素格式：相机 " << h.camera_id << " 帧 " << h.sequence << std::endl;
+        return false;
+    }
+    // 行跨度取自帧头，直接引用映射的数据，不复制
+    size_t step = h.bytesperline != 0 ? h.bytesperline : h.width * 2;
+    // 录制时超出槽大小的帧被截断，损坏的帧头也可能给出过大的尺寸，数据不足整帧时不转换
+    if (h.width == 0 || h.height == 0 || step < static_cast<size_t>(h.width) * 2 ||
+        h.payload_size < static_cast<uint64_t>(step) * h.height) {
+        std::cerr << "帧数据不完整：相机 " << h.camera_id << " 帧 " << h.sequence << "（" << h.payload_size << " 字节，需要 "
+                  << static_cast<uint64_t>(step) * h.height << " 字节）" << std::endl;
+        return false;
+    }
+    cv::Mat yuyv(h.height, h.width, CV_8UC2, const_cast<uint8_t*>(frame.payload), step);
+    cv::Mat bgr;
+    cv::cvtColor(yuyv, bgr, cv::COLOR_YUV2BGR_YUYV);
+    if (!cv::imwrite(filename, bgr, params)) {
+        std::cerr << "写入失败：" << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    std::string input_folder = "data";
+    std::string output_folder = "output";
+    std::string extension = ".jpg";
+    int quality = 95;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // 解析命令行参数
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--input" && i + 1 < argc) {
+            input_folder = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            output_folder = argv[++i];
+        } else if (arg == "--png") {
+            extension = ".png";
+        } else if (arg == "--quality" && i + 1 < argc) {
+            quality = std::clamp(std::atoi(argv[++i]), 1, 100);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "用法：" << argv[0] << " [--input 目录] [--output 目录] [--png] [--quality N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (mkdir(output_folder.c_str(), 0777) == -1 && errno != EEXIST) {
+        std::cerr << "创建目录失败：" << output_folder << " - " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // 打开所有容器分段并收集帧
+    std::vector<std::unique_ptr<ContainerReader>> readers;
+    std::vector<ConvertTask> tasks;
+    for (const std::string& path : list_containers(input_folder)) {
+        auto reader = std::make_unique<ContainerReader>();
+        std::string error;
+        if (!reader->open(path, error)) {
+            std::cerr << "跳过 " << path << "：" << error << std::endl;
+            continue;
+        }
+        for (size_t i = 0; i < reader->frame_count(); ++i) {
+            tasks.push_back({reader.get(), i});
+        }
+        readers.push_back(std::move(reader));
+    }
+    if (tasks.empty()) {
+        std::cout << "没有需要转换的帧。" << std::endl;
+        return 0;
+    }
+
+    // 并行由本程序的线程完成，关闭OpenCV内部的线程池避免超额订阅
+    cv::setNumThreads(0);
+    std::vector<int> params;
+    if (extension == ".jpg") {
+        params = {cv::IMWRITE_JPEG_QUALITY, quality};
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    std::atomic<size_t> next_task(0);
+    std::atomic<size_t> converted(0);
+    std::vector<std::thread> workers;
+    threads = std::min<int>(threads, tasks.size());
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i = next_task.fetch_add(1); i < tasks.size(); i = next_task.fetch_add(1)) {
+                const ConvertTask& task = tasks[i];
+                if (convert_frame(task.reader->frame(task.index), output_folder, extension, params)) {
+                    converted.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    std::cout << "已转换 " << converted.load() << "/" << tasks.size() << " 帧（" << readers.size() << " 个分段，"
+              << threads << " 个线程），用时 " << seconds << " 秒" << std::endl;
+    return converted.load() == tasks.size() ? 0 : 1;
+}
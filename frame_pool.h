@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+// 固定容量的帧池：所有槽一次性分配在一块按缓存行对齐的连续内存中并预先触碰，
+// 空闲槽用带版本号的无锁栈管理，acquire/release 既不加锁也不分配内存，
+// 运行期间不会产生 malloc 和缺页
+class FramePool {
+public:
+    static constexpr size_t CACHE_LINE = 64;
+
+    FramePool() = default;
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+    ~FramePool() { std::free(memory_); }
+
+    // 分配 slot_count 个槽，每个槽至少 slot_size 字节，起始地址按 alignment 对齐。
+    // 只能在没有其他线程使用帧池时调用，失败时返回false
+    bool init(size_t slot_count, size_t slot_size, size_t alignment = CACHE_LINE) {
+        std::free(memory_);
+        memory_ = nullptr;
+        capacity_ = 0;
+
+        slot_size_ = slot_size;
+        slot_stride_ = (slot_size + alignment - 1) / alignment * alignment;
+        memory_ = static_cast<uint8_t*>(std::aligned_alloc(alignment, slot_stride_ * slot_count));
+        if (memory_ == nullptr) {
+            return false;
+        }
+        // 预先触碰所有页面，避免采集过程中缺页
+        memset(memory_, 0, slot_stride_ * slot_count);
+
+        next_ = std::make_unique<std::atomic<uint32_t>[]>(slot_count);
+        for (size_t i = 0; i < slot_count; ++i) {
+            next_[i].store(i + 1 < slot_count ? static_cast<uint32_t>(i + 1) : NIL, std::memory_order_relaxed);
+        }
+        capacity_ = slot_count;
+        head_.store(pack(slot_count > 0 ? 0 : NIL, 0), std::memory_order_release);
+        available_.store(static_cast<int>(slot_count), std::memory_order_relaxed);
+        return true;
+    }
+
+    // 取出一个空闲槽，帧池已空时返回-1
+    int acquire() {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t slot = index_of(head);
+            if (slot == NIL) {
+                return -1;
+            }
+            uint32_t next = next_[slot].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, pack(next, tag_of(head) + 1),
+                                            std::memory_order_acq_rel, std::memory_order_acquire)) {
+                available_.fetch_sub(1, std::memory_order_relaxed);
+                return static_cast<int>(slot);
+            }
+        }
+    }
+
+    // 归还槽
+    void release(int slot) {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        do {
+            next_[slot].store(index_of(head), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, pack(slot, tag_of(head) + 1),
+                                              std::memory_order_release, std::memory_order_relaxed));
+        available_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint8_t* data(int slot) const { return memory_ + slot * slot_stride_; }
+    size_t slot_size() const { return slot_size_; }
+    size_t capacity() const { return capacity_; }
+    // 当前空闲槽数量，仅供统计，并发时是近似值
+    int available() const { return available_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    // 栈顶：低32位为槽编号，高32位为版本号，防止ABA问题
+    static uint64_t pack(uint32_t slot, uint32_t tag) { return (static_cast<uint64_t>(tag) << 32) | slot; }
+    static uint32_t index_of(uint64_t head) { return static_cast<uint32_t>(head); }
+    static uint32_t tag_of(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> head_{pack(NIL, 0)};
+    alignas(CACHE_LINE) std::atomic<int> available_{0};
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    uint8_t* memory_ = nullptr;
+    size_t capacity_ = 0;
+    size_t slot_size_ = 0;
+    size_t slot_stride_ = 0;
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// 单槽"最新覆盖"信箱（三缓冲）：写入方总是写自己的后台缓冲区，发布时与中间缓冲区交换；
+// 读取方只在有新帧时把中间缓冲区换到前台。双方都不等待，读取方慢时旧帧直接被覆盖，
+// 只保留最新一帧。Meta 为随帧发布的元数据。
+//
+// 同一时刻只能有一个写入方：写入前用 try_begin_write 抢占，抢不到说明另一个线程正在写，
+// 直接放弃这一帧即可
+template <typename Meta>
+class LatestMailbox {
+public:
+    LatestMailbox() = default;
+    LatestMailbox(const LatestMailbox&) = delete;
+    LatestMailbox& operator=(const LatestMailbox&) = delete;
+    ~LatestMailbox() { std::free(memory_); }
+
+    // 分配三个各 slot_size 字节的缓冲区，只能在没有其他线程使用信箱时调用
+    bool init(size_t slot_size) {
+        std::free(memory_);
+        slot_stride_ = (slot_size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+        memory_ = static_cast<uint8_t*>(std::aligned_alloc(CACHE_LINE, slot_stride_ * 3));
+        if (memory_ == nullptr) {
+            slot_size_ = 0;
+            return false;
+        }
+        memset(memory_, 0, slot_stride_ * 3);
+        slot_size_ = slot_size;
+        back_ = 0;
+        front_ = 1;
+        state_.store(2);
+        return true;
+    }
+
+    size_t slot_size() const { return slot_size_; }
+
+    // 抢占写入权，成功时返回后台缓冲区，之后必须调用 publish 或 cancel_write
+    uint8_t* try_begin_write() {
+        if (memory_ == nullptr || writing_.exchange(true, std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return memory_ + back_ * slot_stride_;
+    }
+
+    // 发布后台缓冲区中的帧，覆盖读取方尚未取走的旧帧
+    void publish(const Meta& meta) {
+        meta_[back_] = meta;
+        uint32_t previous = state_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        back_ = previous & INDEX_MASK;
+        writing_.store(false, std::memory_order_release);
+    }
+
+    void cancel_write() { writing_.store(false, std::memory_order_release); }
+
+    // 有新帧时把它换到前台并返回true，前台缓冲区在下一次 take 之前有效
+    bool take(const uint8_t*& data, Meta& meta) {
+        if ((state_.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        uint32_t previous = state_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & INDEX_MASK;
+        data = memory_ + front_ * slot_stride_;
+        meta = meta_[front_];
+        return true;
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr uint32_t INDEX_MASK = 3;
+    static constexpr uint32_t FRESH = 4;
+
+    uint8_t* memory_ = nullptr;
+    size_t slot_size_ = 0;
+    size_t slot_stride_ = 0;
+    Meta meta_[3] = {};
+    uint32_t back_ = 0;   // 只由当前写入方访问
+    uint32_t front_ = 1;  // 只由读取方访问
+    alignas(CACHE_LINE) std::atomic<uint32_t> state_{2};  // 中间缓冲区序号 | FRESH
+    alignas(CACHE_LINE) std::atomic<bool> writing_{false};
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// 有界无锁队列（Vyukov 环形队列）：多个生产者、一个或多个消费者，
+// 每个槽带序号，push/pop 只在成功时做一次CAS，不加锁也不分配内存。
+// 容量向上取整为2的幂
+template <typename T>
+class LockFreeQueue {
+public:
+    static constexpr size_t CACHE_LINE = 64;
+
+    LockFreeQueue() = default;
+    explicit LockFreeQueue(size_t capacity) { init(capacity); }
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // 只能在没有其他线程使用队列时调用
+    void init(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_ = std::make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    // 队列已满时返回false，value 保持不变
+    bool try_push(T&& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 队列为空时返回false
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 近似的元素个数，仅供统计和判断是否需要休眠
+    size_t size_approx() const {
+        size_t enq = enqueue_pos_.load(std::memory_order_acquire);
+        size_t deq = dequeue_pos_.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+    bool empty_approx() const { return size_approx() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct alignas(CACHE_LINE) Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos_{0};
+    alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos_{0};
+};
+
+// 消费者空闲时的唤醒器：消费者没有数据时在eventfd上休眠，
+// 生产者只有在消费者确实休眠时才写eventfd，忙碌时入队不产生系统调用
+class QueueWaker {
+public:
+    QueueWaker() : fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+    QueueWaker(const QueueWaker&) = delete;
+    QueueWaker& operator=(const QueueWaker&) = delete;
+    ~QueueWaker() {
+        if (fd_ != -1) {
+            close(fd_);
+        }
+    }
+
+    // 生产者入队后调用
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+            uint64_t one = 1;
+            while (write(fd_, &one, sizeof(one)) == -1 && errno == EINTR) {
+            }
+        }
+    }
+
+    // 消费者在 has_work() 为false时休眠，直到被唤醒或超时（毫秒，-1为不超时）
+    template <typename Pred>
+    void wait(Pred has_work, int timeout_ms = -1) {
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work()) {
+            struct pollfd pfd = {fd_, POLLIN, 0};
+            poll(&pfd, 1, timeout_ms);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+        uint64_t value;
+        while (read(fd_, &value, sizeof(value)) > 0) {
+        }
+    }
+
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+    alignas(64) std::atomic<bool> sleeping_{false};
+};
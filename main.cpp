@@ -11,30 +11,316 @@
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <linux/videodev2.h>
 #include <ctime>
-#include <fstream>
 #include <opencv2/opencv.hpp>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <queue>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <array>
+#include <deque>
+#include <unordered_map>
 
-constexpr int NUM_CAMERAS = 6;
-constexpr int FRAME_WIDTH = 1280;
-constexpr int FRAME_HEIGHT = 720;
+#include "camera_config.h"
+#include "capture_source.h"
+#include "control.h"
+#include "disk_writer.h"
+#include "frame_container.h"
+#include "frame_pool.h"
+#include "latest_mailbox.h"
+#include "lockfree_queue.h"
+#include "metrics.h"
+#include "mjpeg_decode.h"
+#include "pretrigger_ring.h"
+#include "record_queue.h"
+#include "slot_scheduler.h"
+#include "snapshot_job.h"
+#include "thread_placement.h"
+#include "yuyv_convert.h"
+
+constexpr int MAX_CAMERAS = 16;           // 每个相机状态数组的容量，实际相机数由配置或设备发现决定
+constexpr int DEFAULT_FRAME_WIDTH = 1280;  // 配置文件没有给出分辨率时使用
+constexpr int DEFAULT_FRAME_HEIGHT = 720;
+constexpr int PREVIEW_WIDTH = 640;
+constexpr int PREVIEW_HEIGHT = 480;
+constexpr int MOSAIC_TILE_WIDTH = 640;   // 拼接预览中每个相机的画面大小
+constexpr int MOSAIC_TILE_HEIGHT = 360;
+constexpr int MOSAIC_COLUMNS = 3;
+constexpr int DEFAULT_NUM_BUFFERS = 4;  // 每个相机默认的mmap缓冲区数量，不含历史帧
+constexpr int DEFAULT_FPS = 30;          // 默认目标帧率，0表示使用驱动默认值
+constexpr int DEFAULT_HISTORY_DEPTH = 2; // 同步快照默认保留的历史帧数
+constexpr size_t SNAPSHOT_REQUEST_DEPTH = 64;  // 每个相机排队的快照请求上限
+constexpr auto RECONNECT_INTERVAL = std::chrono::seconds(1);  // 掉线相机的重试间隔
+constexpr auto STALL_TIMEOUT = std::chrono::seconds(5);       // 这么久没有出帧的相机视为掉线
+constexpr int DEFAULT_RECORD_POOL_FRAMES = 48;  // 录制帧池默认大小
+constexpr int DEFAULT_WRITER_THREADS = 2;       // 写线程池默认线程数
+constexpr uint64_t DEFAULT_SEGMENT_MB = 1024;   // 容器分段默认大小
+constexpr int DEFAULT_PREVIEW_FPS = 15;         // 预览默认刷新率上限
+constexpr int DEFAULT_PRETRIGGER_MB = 256;          // 每个相机预触发环默认的内存上限
+constexpr double DEFAULT_POSTTRIGGER_SECONDS = 5.0; // 事件触发后默认写出的秒数
+constexpr double PRETRIGGER_WRITE_MARGIN = 0.5;     // 预触发环在触发前窗口之外多留的秒数，供触发后的帧等待写盘
+constexpr int64_t EVENT_CLOSE_DELAY_US = 1000000;   // 触发后窗口结束这么久之后关闭事件片段
+
+// 录制时帧池满（磁盘跟不上）的处理策略
+enum class RecordPolicy {
+    Block,       // 阻塞采集，等待空闲槽
+    DropOldest,  // 覆盖队列中最旧的未写盘帧
+    DropNewest,  // 丢弃当前帧
+};
+
+// 帧间隔抖动直方图的桶上限（微秒），最后一个桶收集超过最大上限的样本
+constexpr int64_t JITTER_BUCKETS_US[] = {500, 1000, 2000, 5000, 10000, 20000};
+constexpr int NUM_JITTER_BUCKETS = sizeof(JITTER_BUCKETS_US) / sizeof(JITTER_BUCKETS_US[0]) + 1;
+
+// 默认采集格式，可通过 --format yuyv|mjpeg 修改。MJPEG 帧按原样写盘，只在预览时解码
+uint32_t capture_pixelformat = V4L2_PIX_FMT_YUYV;
+// 相机数量和每个相机的设备、格式、帧率和缓冲区数，来自 --config 配置文件，
+// 没有配置文件时使用发现的所有采集设备和命令行给出的默认值
+int num_cameras = 0;
+std::vector<CameraConfig> camera_configs;
+// 每个相机默认申请的缓冲区数量，可通过 --buffers N 修改
+int num_buffers = DEFAULT_NUM_BUFFERS;
+// 采集反应器线程数量，相机按编号轮流分配给各反应器，可通过 --reactors N 修改
+int num_reactors = 1;
+// 默认目标帧率，由驱动按 timeperframe 控制，可通过 --fps N 修改，--fps ID:N 覆盖一个相机的配置
+int default_fps = DEFAULT_FPS;
+// 每个相机保留的历史帧数，用于同步快照，可通过 --history N 修改。
+// 历史帧占用V4L2缓冲区，所以每个相机在 --buffers（或配置的 buffers）之外另外申请这么多个，
+// 驱动中仍保留原来的缓冲区数，代价是每个相机多占 N 帧的内存。
+// 驱动分配的缓冲区不够时，实际深度不超过缓冲区数量减2（驱动和保存线程各至少一个）
+int history_depth = DEFAULT_HISTORY_DEPTH;
+// 录制帧池大小和帧池满时的策略，可通过 --pool-frames N 和 --record-policy 修改
+int record_pool_frames = DEFAULT_RECORD_POOL_FRAMES;
+RecordPolicy record_policy = RecordPolicy::Block;
+// 写盘后端，可通过 --writer sync|pool|uring、--writer-threads N 和 --direct（O_DIRECT）修改
+WriterBackend writer_backend = WriterBackend::Pool;
+int writer_threads = DEFAULT_WRITER_THREADS;
+bool direct_io = false;
+// 容器分段大小，可通过 --segment-mb N 修改
+uint64_t segment_bytes = DEFAULT_SEGMENT_MB << 20;
+// 预览的相机和刷新率上限，可通过 --preview-camera N、--preview-fps N 和 --no-preview 修改，
+// 运行时在预览窗口中按数字键切换相机。--mosaic（或窗口中按 m）拼接显示所有相机，
+// 此时刷新率上限对每个相机分别生效
+std::atomic<int> preview_camera(0);
+std::atomic<bool> preview_mosaic(false);
+int preview_fps = DEFAULT_PREVIEW_FPS;
+bool preview_enabled = true;
+// 线程放置，可通过 --capture-cpus、--capture-priority、--writer-cpus 和 --preview-cpus 修改，CPU 集合的写法见 thread_placement.h。
+// 采集反应器轮流绑定到采集集合中的单个CPU；保存线程、录制线程和写盘后端的写线程共用写盘集合。
+// OpenCV 只在预览线程中使用，它的工作线程由预览线程创建并继承预览线程的绑定，线程数可通过 --opencv-threads N 限制
+// 事件片段：按 e 触发后每个相机写出预触发环中触发前的帧和触发后 --posttrigger 秒内的帧。
+// 触发前的秒数和预触发环的内存上限可通过 --pretrigger 秒、--pretrigger-mb N 或配置文件的 pretrigger、pretrigger_mb 设置
+double pretrigger_seconds = 0.0;
+int pretrigger_mb = DEFAULT_PRETRIGGER_MB;
+double posttrigger_seconds = DEFAULT_POSTTRIGGER_SECONDS;
+ThreadPlacement capture_placement;
+ThreadPlacement writer_placement;
+ThreadPlacement preview_placement;
+int opencv_threads = -1;  // -1 表示使用 OpenCV 的默认值
 
 // 全局变量
-std::vector<void*> buffer_start(NUM_CAMERAS);
-std::vector<int> fds(NUM_CAMERAS);
-std::vector<struct v4l2_buffer> buffers(NUM_CAMERAS);
-std::atomic<bool> capture_images(false);
-std::vector<std::atomic<bool>> camera_saved(NUM_CAMERAS);
+std::vector<std::unique_ptr<CaptureSource>> capture_sources(MAX_CAMERAS);  // 每个相机的采集源，第一次打开时创建
+std::vector<size_t> frame_size(MAX_CAMERAS, 0);  // 采集源协商的每帧最大字节数（sizeimage）
+std::vector<struct v4l2_pix_format> frame_format(MAX_CAMERAS);  // 采集源协商的格式，写入容器帧头
+std::vector<int64_t> last_sequence(MAX_CAMERAS, -1);  // 上一帧的驱动帧序号，-1表示还没有帧
+std::vector<std::chrono::steady_clock::time_point> last_frame_time(MAX_CAMERAS);
+std::vector<int64_t> frame_interval_us(MAX_CAMERAS, 0);     // 采集源确认的帧间隔，0表示未知
+std::vector<int64_t> last_timestamp_us(MAX_CAMERAS, -1);    // 上一帧的驱动时间戳，重新连接后为-1
+std::vector<int64_t> last_interval_us(MAX_CAMERAS, 0);      // 上一个帧间隔
+std::vector<uint64_t> timed_intervals(MAX_CAMERAS, 0);      // 统计过的帧间隔数，掉线期间不计
+std::vector<int64_t> timed_span_us(MAX_CAMERAS, 0);         // 这些帧间隔的总时长，用于计算实际帧率
+std::vector<std::array<uint64_t, NUM_JITTER_BUCKETS>> jitter_histogram(MAX_CAMERAS);
+std::vector<std::atomic<uint64_t>> captured_frames(MAX_CAMERAS);
+std::vector<std::atomic<uint64_t>> dropped_frames(MAX_CAMERAS);
+std::vector<std::atomic<int>> leased_buffers(MAX_CAMERAS);  // 已取出、尚未归还给驱动的缓冲区数
+std::vector<std::atomic<bool>> camera_streaming(MAX_CAMERAS);
+
+// 掉线和重连统计，只由相机所属的采集反应器修改，退出时输出
+struct ReconnectStats {
+    uint64_t losses = 0;
+    uint64_t reconnects = 0;
+    int64_t total_outage_us = 0;   // 掉线到重新开始采集
+    int64_t max_outage_us = 0;
+    int64_t max_latency_us = 0;    // 设备节点重新出现到重新开始采集
+};
+std::vector<ReconnectStats> reconnect_stats(MAX_CAMERAS);
+std::atomic<int> finished_cameras(0);  // 回放已结束的相机数
+
+// 指标，采集路径上只做relaxed原子操作，由 --stats-interval 定期输出或经 --metrics-socket 读取
+std::vector<LatencyHistogram> buffer_hold_ns(MAX_CAMERAS);       // DQBUF 到 QBUF
+std::vector<LatencyHistogram> snapshot_latency_ns(MAX_CAMERAS);  // 采集时间戳到快照写盘完成
+std::vector<LatencyHistogram> record_latency_ns(MAX_CAMERAS);    // 采集时间戳到录制写盘完成
+std::vector<LatencyHistogram> record_wait_ns(MAX_CAMERAS);       // Block策略下等待录制帧池槽的时间
+std::vector<std::atomic<uint64_t>> bytes_written(MAX_CAMERAS);
+int stats_interval = 0;            // 秒，0表示不定期输出
+std::string metrics_socket_path;   // 为空表示不提供指标套接字
+ControlServer control_server;      // 汇集标准输入、控制套接字、命名管道和GPIO/输入设备的命令
 std::atomic<bool> exit_program(false);
+std::atomic<bool> stop_saver(false);  // 所有相机线程退出后才停止保存线程
+int exit_event_fd = -1;  // 退出时用于唤醒采集反应器的eventfd
+
+// 预览信箱：采集线程按刷新率上限把相机的最新一帧复制进来，预览线程取走后转换显示，
+// 采集线程从不等待显示。YUYV 帧只复制缩小时会用到的行，信箱中的帧行数即目标高度；
+// MJPEG 帧复制压缩数据，由预览线程解码
+struct PreviewFrame {
+    int camera_id = -1;
+    uint32_t sequence = 0;
+    uint32_t pixelformat = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;        // YUYV：复制的行数
+    uint32_t bytesperline = 0;  // YUYV：信箱中的行跨度
+    size_t size = 0;            // MJPEG：压缩数据字节数
+};
+std::vector<LatestMailbox<PreviewFrame>> preview_mailboxes(MAX_CAMERAS);
+std::vector<std::atomic<int64_t>> preview_next_us(MAX_CAMERAS);  // 下一次允许发布预览帧的驱动时间戳
+
+// 当前 CLOCK_MONOTONIC 时间（微秒），与驱动时间戳同一时钟
+int64_t monotonic_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 从采集源取出的缓冲区，可以留在历史环中或借给保存线程直接从缓冲区（V4L2 的mmap区域）写盘，
+// 租借对象销毁（或release）时把缓冲区还给采集源，避免复制整帧
+class BufferLease {
+public:
+    BufferLease() = default;
+    BufferLease(int camera_id, const CapturedFrame& frame)
+        : camera_id_(camera_id), frame_(frame), dequeue_ns_(writer_now_ns()) {
+        leased_buffers[camera_id_].fetch_add(1);
+    }
+    BufferLease(BufferLease&& other) noexcept
+        : camera_id_(other.camera_id_), frame_(other.frame_), dequeue_ns_(other.dequeue_ns_) {
+        other.camera_id_ = -1;
+    }
+    BufferLease& operator=(BufferLease&& other) noexcept {
+        if (this != &other) {
+            release();
+            camera_id_ = other.camera_id_;
+            frame_ = other.frame_;
+            dequeue_ns_ = other.dequeue_ns_;
+            other.camera_id_ = -1;
+        }
+        return *this;
+    }
+    BufferLease(const BufferLease&) = delete;
+    BufferLease& operator=(const BufferLease&) = delete;
+    ~BufferLease() { release(); }
+
+    int camera_id() const { return camera_id_; }
+    const uint8_t* data() const { return capture_sources[camera_id_]->data(frame_.index); }
+    size_t size() const { return frame_.size; }
+    size_t capacity() const { return capture_sources[camera_id_]->capacity(frame_.index); }
+    uint32_t sequence() const { return frame_.sequence; }
+    int64_t timestamp_us() const { return frame_.timestamp_us; }
+
+    // 把缓冲区还给采集源
+    void release() {
+        if (camera_id_ < 0) {
+            return;
+        }
+        capture_sources[camera_id_]->requeue(frame_.index);
+        buffer_hold_ns[camera_id_].record(writer_now_ns() - dequeue_ns_);
+        leased_buffers[camera_id_].fetch_sub(1);
+        leased_buffers[camera_id_].notify_all();
+        camera_id_ = -1;
+    }
+
+private:
+    int camera_id_ = -1;
+    CapturedFrame frame_;
+    int64_t dequeue_ns_ = 0;
+};
+
+// 快照请求：控制线程把请求放入每个参与相机的请求队列，采集反应器按顺序用之后的帧满足
+std::vector<LockFreeQueue<std::shared_ptr<SnapshotJob>>> snapshot_requests(MAX_CAMERAS);
+std::vector<std::deque<std::shared_ptr<SnapshotJob>>> snapshot_jobs(MAX_CAMERAS);  // 已取出还没有满足的请求，只由采集反应器访问
+std::atomic<uint64_t> snapshot_job_id(0);  // 已提交的快照请求数，也是最近一次的编号
+LatencyHistogram snapshot_job_ns;          // 请求到最后一个相机写盘完成
+
+// 交给保存线程的一帧和它所属的快照请求
+struct SaveRequest {
+    BufferLease lease;
+    std::shared_ptr<SnapshotJob> job;
+};
+
+// 无锁队列，用于保存待写入磁盘的图像数据，容量在启动时按缓冲区总数确定
+LockFreeQueue<SaveRequest> image_queue;
+QueueWaker saver_waker;  // 保存线程空闲时在此休眠
+
+// 每个相机最近的若干帧，只由负责该相机的采集反应器访问
+std::vector<std::deque<BufferLease>> frame_history(MAX_CAMERAS);
+
+// 录制帧池中一个槽的元数据，帧数据在 record_pool 的对应槽中
+struct RecordSlot {
+    size_t size = 0;
+    int camera_id = -1;
+    int session = 0;
+    uint32_t sequence = 0;
+    int64_t timestamp_us = 0;
+};
 
-// 线程安全的队列，用于保存待写入磁盘的图像数据
-std::queue<std::pair<int, std::vector<uint8_t>>> image_queue;
-std::mutex queue_mutex;
-std::condition_variable queue_cv;
+// 连续录制：采集反应器把帧复制进固定大小的帧池，录制线程按顺序写盘
+std::atomic<bool> recording(false);
+std::atomic<int> record_session(0);  // 每次开始录制加一，录制线程据此切换文件
+FramePool record_pool;
+std::vector<RecordSlot> record_slots;  // 与 record_pool 的槽一一对应
+SlotScheduler record_scheduler(MAX_CAMERAS);  // 帧池饱和时按权重在相机之间分配槽
+RecordQueue record_queue;              // 等待写盘的槽编号，按采集顺序
+QueueWaker recorder_waker;             // 录制线程空闲时在此休眠
+std::mutex record_mutex;
+std::condition_variable record_free_cv;  // 帧池有空闲槽
+std::atomic<int> record_free_waiters(0); // 等待空闲槽的采集线程数，为0时归还槽不需要通知
+std::vector<std::atomic<uint64_t>> recorded_frames(MAX_CAMERAS);
+std::vector<std::atomic<uint64_t>> record_blocked(MAX_CAMERAS);         // Block策略下等待空闲槽的次数
+std::vector<std::atomic<uint64_t>> record_dropped_oldest(MAX_CAMERAS);  // 被覆盖的旧帧数
+std::vector<std::atomic<uint64_t>> record_dropped_newest(MAX_CAMERAS);  // 被丢弃的新帧数
+
+// 快照和录制各用一个写盘后端，分别统计吞吐量和延迟
+std::unique_ptr<DiskWriter> snapshot_writer;
+std::unique_ptr<DiskWriter> record_writer;
+
+// 事件片段：采集反应器把帧复制进各自的预触发环，事件期间被钉住的槽经事件队列交给事件线程写盘
+struct EventFrame {
+    int camera_id = -1;
+    int slot = -1;
+    int event = 0;
+};
+std::vector<PretriggerRing> pretrigger_rings(MAX_CAMERAS);
+std::vector<size_t> pretrigger_planned_slots(MAX_CAMERAS, 0);  // 按配置估计的槽数，事件队列按总和分配
+LockFreeQueue<EventFrame> event_queue;
+QueueWaker event_waker;                   // 事件线程空闲时在此休眠
+std::mutex event_mutex;                   // 串行化触发
+std::atomic<int> event_id(0);             // 最近一次事件的编号，0表示还没有事件
+std::atomic<int64_t> event_trigger_us(0); // 触发时刻（CLOCK_MONOTONIC）
+std::atomic<int64_t> event_end_us(0);     // 触发后窗口的结束时刻，窗口内再次触发时延长
+std::vector<int> event_flushed(MAX_CAMERAS, 0);  // 已写出触发前窗口的事件编号，只由相机所属的采集反应器访问
+std::vector<std::atomic<uint64_t>> event_frames(MAX_CAMERAS);   // 写入事件片段的帧数
+std::vector<std::atomic<uint64_t>> event_dropped(MAX_CAMERAS);  // 环中的槽都在等待写盘而没能写入片段的帧数
+std::unique_ptr<DiskWriter> event_writer;
+
+// 录制帧池槽的布局：[容器帧头块][帧数据]，整块一次写入容器
+size_t record_header_block = 0;
+
+// 正在写盘的快照，帧头块和帧数据两次写都完成后归还缓冲区和帧头槽
+struct PendingSnapshot {
+    BufferLease lease;
+    std::shared_ptr<SnapshotJob> job;
+    int header_slot = -1;
+    int remaining = 0;
+    bool failed = false;
+    std::string path;
+};
+FramePool snapshot_headers;  // 快照帧头块，帧数据直接从V4L2缓冲区写出
+std::mutex snapshot_mutex;
+std::unordered_map<uint64_t, PendingSnapshot> pending_snapshots;
 
 // 创建目录的函数
 void create_directory(const std::string& folder_name) {
@@ -47,261 +333,1716 @@ void create_directory(const std::string& folder_name) {
     }
 }
 
-// 相机采集函数
-void capture_camera(int camera_id) {
-    std::string device = "/dev/video" + std::to_string(camera_id * 2);
+// 相机设备路径
+std::string camera_device(int camera_id) {
+    return camera_configs[camera_id].device;
+}
+
+// 请求退出：设置退出标志并唤醒所有采集反应器
+void request_exit() {
+    {
+        // 唤醒因帧池满而阻塞的采集线程
+        std::lock_guard<std::mutex> lock(record_mutex);
+        exit_program = true;
+    }
+    record_free_cv.notify_all();
+    uint64_t one = 1;
+    if (exit_event_fd != -1 && write(exit_event_fd, &one, sizeof(one)) == -1) {
+        std::cerr << "唤醒采集线程失败：" << strerror(errno) << std::endl;
+    }
+}
+
+// 根据驱动时间戳统计帧率和帧间隔抖动
+void record_frame_timing(int camera_id, int64_t ts) {
+    if (last_timestamp_us[camera_id] >= 0) {
+        int64_t interval = ts - last_timestamp_us[camera_id];
+        ++timed_intervals[camera_id];
+        timed_span_us[camera_id] += interval;
+        // 帧间隔未知时以上一个间隔作为参考
+        int64_t expected = frame_interval_us[camera_id] > 0 ? frame_interval_us[camera_id] : last_interval_us[camera_id];
+        if (expected > 0) {
+            int64_t jitter = std::abs(interval - expected);
+            int bucket = 0;
+            while (bucket < NUM_JITTER_BUCKETS - 1 && jitter > JITTER_BUCKETS_US[bucket]) {
+                ++bucket;
+            }
+            ++jitter_histogram[camera_id][bucket];
+        }
+        last_interval_us[camera_id] = interval;
+    }
+    last_timestamp_us[camera_id] = ts;
+}
 
-    // 打开相机设备
-    fds[camera_id] = open(device.c_str(), O_RDWR | O_NONBLOCK);
-    if (fds[camera_id] == -1) {
-        std::cerr << "无法打开设备：" << device << " - " << strerror(errno) << std::endl;
+// 分配相机的预触发环，只在第一次打开相机、知道帧大小之后分配。
+// 槽数为按配置估计的槽数，不超过内存上限；重新连接后帧变大时超出部分被截断
+void init_pretrigger_ring(int camera_id) {
+    const CameraConfig& config = camera_configs[camera_id];
+    PretriggerRing& ring = pretrigger_rings[camera_id];
+    size_t alignment = ContainerWriter::alignment_for(direct_io);
+    size_t header_block = align_up(sizeof(FrameHeader), alignment);
+    size_t slot_bytes = header_block + align_up(frame_size[camera_id], alignment);
+    size_t budget = static_cast<size_t>(config.pretrigger_mb) << 20;
+    size_t slots = std::min(pretrigger_planned_slots[camera_id], budget / slot_bytes);
+    if (slots < 2 || !ring.init(slots, frame_size[camera_id], header_block, alignment)) {
+        std::cerr << "相机 " << camera_id << " 的预触发环分配失败：" << slots << " x " << slot_bytes << " 字节，上限 "
+                  << config.pretrigger_mb << " MB" << std::endl;
         return;
     }
+    double fps = frame_interval_us[camera_id] > 0 ? 1e6 / frame_interval_us[camera_id]
+                 : config.fps > 0                 ? config.fps
+                                                  : DEFAULT_FPS;
+    std::cout << "相机 " << camera_id << " 的预触发环：" << slots << " 帧，" << ((slots * slot_bytes) >> 20)
+              << " MB，约 " << std::round((slots / fps - PRETRIGGER_WRITE_MARGIN) * 10) / 10 << " 秒" << std::endl;
+}
+
+// 打开相机的采集源（设备、录制回放或合成数据），失败时采集源已释放申请的资源
+bool open_camera(int camera_id) {
+    const CameraConfig& config = camera_configs[camera_id];
+    if (config.device.empty()) {
+        std::cerr << "相机 " << camera_id << " 没有对应的设备" << std::endl;
+        return false;
+    }
+    if (!capture_sources[camera_id]) {
+        capture_sources[camera_id] = make_capture_source(camera_id, config);
+    }
+    CaptureSource& source = *capture_sources[camera_id];
+    if (!source.open(config)) {
+        return false;
+    }
+    frame_size[camera_id] = source.format().sizeimage;
+    frame_format[camera_id] = source.format();
+    frame_interval_us[camera_id] = source.frame_interval_us();
+
+    if (pretrigger_planned_slots[camera_id] > 0 && pretrigger_rings[camera_id].capacity() == 0) {
+        init_pretrigger_ring(camera_id);
+    }
+
+    last_frame_time[camera_id] = std::chrono::steady_clock::now();
+    last_sequence[camera_id] = -1;  // 重新连接后驱动的帧序号从头开始
+    // 掉线前后的两帧之间不算一个帧间隔，否则中断会计入抖动并拉低实际帧率
+    last_timestamp_us[camera_id] = -1;
+    last_interval_us[camera_id] = 0;
+    camera_streaming[camera_id] = true;
+    record_scheduler.set_active(camera_id, true);
+    return true;
+}
+
+// 相机不再出帧：还没有满足的快照请求以失败结束，不再等待这个相机
+void fail_snapshot_jobs(int camera_id) {
+    std::shared_ptr<SnapshotJob> job;
+    while (snapshot_requests[camera_id].try_pop(job)) {
+        snapshot_jobs[camera_id].push_back(std::move(job));
+    }
+    for (const std::shared_ptr<SnapshotJob>& pending : snapshot_jobs[camera_id]) {
+        pending->finish(camera_id, false, monotonic_now_us());
+    }
+    snapshot_jobs[camera_id].clear();
+}
+
+// 停止采集并释放相机资源
+void close_camera(int camera_id) {
+    camera_streaming[camera_id] = false;
+    // 不再为它保留帧池份额，等待空闲槽的其他相机可能因此可以借用
+    record_scheduler.set_active(camera_id, false);
+    if (record_free_waiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        record_free_cv.notify_all();
+    }
+    frame_history[camera_id].clear();
+
+    fail_snapshot_jobs(camera_id);
+
+    // 等待保存线程归还所有借出的缓冲区，之后才能停止视频流并解除映射
+    for (int n = leased_buffers[camera_id].load(); n != 0; n = leased_buffers[camera_id].load()) {
+        leased_buffers[camera_id].wait(n);
+    }
+    capture_sources[camera_id]->close();
+}
 
-    // 查询设备能力
-    struct v4l2_capability cap;
-    if (ioctl(fds[camera_id], VIDIOC_QUERYCAP, &cap) == -1) {
-        std::cerr << "查询设备能力失败：" << device << " - " << strerror(errno) << std::endl;
-        close(fds[camera_id]);
+// 组装写入容器帧头的元数据
+FrameMeta make_frame_meta(int camera_id, uint32_t sequence, int64_t timestamp_us, size_t payload_size) {
+    FrameMeta meta;
+    meta.camera_id = camera_id;
+    meta.sequence = sequence;
+    meta.timestamp_us = timestamp_us;
+    meta.pixelformat = frame_format[camera_id].pixelformat;
+    meta.width = frame_format[camera_id].width;
+    meta.height = frame_format[camera_id].height;
+    meta.bytesperline = frame_format[camera_id].bytesperline;
+    meta.payload_size = payload_size;
+    return meta;
+}
+
+// 录制模式：初始化固定大小的帧池，只在第一次开始录制时分配。
+// 槽大小取各相机中最大的 sizeimage（还没有打开的相机按配置的分辨率估计），前面预留容器帧头块
+void init_record_pool() {
+    std::lock_guard<std::mutex> lock(record_mutex);
+    if (record_pool.capacity() > 0) {
+        return;
+    }
+    size_t slot_size = 0;
+    for (int i = 0; i < num_cameras; ++i) {
+        size_t configured = static_cast<size_t>(camera_configs[i].width) * camera_configs[i].height * 2;
+        slot_size = std::max(slot_size, frame_size[i] > 0 ? frame_size[i] : configured);
+    }
+    if (slot_size == 0) {
+        slot_size = DEFAULT_FRAME_WIDTH * DEFAULT_FRAME_HEIGHT * 2;
+    }
+    // 与容器使用相同的对齐，O_DIRECT 要求缓冲区按块对齐
+    size_t alignment = ContainerWriter::alignment_for(direct_io);
+    record_header_block = align_up(sizeof(FrameHeader), alignment);
+    slot_size = record_header_block + align_up(slot_size, alignment);
+    if (!record_pool.init(record_pool_frames, slot_size, alignment)) {
+        std::cerr << "分配录制帧池失败：" << record_pool_frames << " x " << slot_size << " 字节" << std::endl;
         return;
     }
+    record_slots.resize(record_pool_frames);
+
+    // 调度权重默认取帧率：配置没有给出时按采集源确认的帧间隔，还不知道时按默认帧率
+    std::vector<int> weights(num_cameras);
+    for (int i = 0; i < num_cameras; ++i) {
+        const CameraConfig& config = camera_configs[i];
+        int fps = config.fps > 0                  ? config.fps
+                  : frame_interval_us[i] > 0 ? static_cast<int>(1000000 / frame_interval_us[i])
+                                             : DEFAULT_FPS;
+        weights[i] = config.weight > 0 ? config.weight : std::max(1, fps);
+    }
+    record_scheduler.init(record_pool_frames, weights);
+}
 
-    // 设置视频格式
-    struct v4l2_format fmt;
-    memset(&fmt, 0, sizeof(fmt));
-    fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    fmt.fmt.pix.width = FRAME_WIDTH;
-    fmt.fmt.pix.height = FRAME_HEIGHT;
-    fmt.fmt.pix.pixelformat = V4L2_PIX_FMT_YUYV;
-    fmt.fmt.pix.field = V4L2_FIELD_NONE;
-    if (ioctl(fds[camera_id], VIDIOC_S_FMT, &fmt) == -1) {
-        std::cerr << "设置视频格式失败：" << device << " - " << strerror(errno) << std::endl;
-        close(fds[camera_id]);
+// 开始或停止连续录制，每次开始都写入新的文件
+void toggle_recording() {
+    if (recording.load()) {
+        {
+            std::lock_guard<std::mutex> lock(record_mutex);
+            recording = false;
+        }
+        record_free_cv.notify_all();
+        std::cout << "停止录制" << std::endl;
+        return;
+    }
+    init_record_pool();
+    if (record_pool.capacity() == 0) {
         return;
     }
+    record_session.fetch_add(1);
+    recording = true;
+    std::cout << "开始录制，帧池 " << record_pool.capacity() << " x " << record_pool.slot_size() << " 字节" << std::endl;
+}
+
+// 调度器允许时从帧池取一个空闲槽，失败返回-1
+int try_acquire_record_slot(int camera_id) {
+    if (!record_scheduler.admit(camera_id, record_pool.available())) {
+        return -1;
+    }
+    int slot = record_pool.acquire();
+    if (slot >= 0) {
+        record_scheduler.acquired(camera_id);
+    }
+    return slot;
+}
+
+// 从帧池取一个空闲槽。帧池满、或只剩其他相机的保底份额时按录制策略处理，返回-1表示丢弃当前帧。
+// 用量没有超过份额的相机总能拿到槽，所以阻塞和丢帧只落在超出份额的相机上
+int acquire_record_slot(int camera_id) {
+    int slot = try_acquire_record_slot(camera_id);
+    if (slot >= 0) {
+        return slot;
+    }
+    record_scheduler.throttled(camera_id);
+
+    switch (record_policy) {
+    case RecordPolicy::Block: {
+        // 阻塞采集直到录制线程释放出调度器允许使用的空闲槽
+        record_blocked[camera_id].fetch_add(1, std::memory_order_relaxed);
+        int64_t wait_start = writer_now_ns();
+        std::unique_lock<std::mutex> lock(record_mutex);
+        record_free_waiters.fetch_add(1);
+        record_free_cv.wait(lock, [camera_id, &slot] {
+            slot = try_acquire_record_slot(camera_id);
+            return slot >= 0 || !recording.load() || exit_program.load();
+        });
+        record_free_waiters.fetch_sub(1);
+        record_wait_ns[camera_id].record(writer_now_ns() - wait_start);
+        return slot;
+    }
+    case RecordPolicy::DropOldest: {
+        // 覆盖本相机或超出份额的相机在队列中最旧的、尚未开始写盘的帧，不动份额内的其他相机的帧；
+        // 没有这样的帧时丢弃当前帧
+        slot = record_queue.withdraw_oldest([camera_id](int victim) {
+            return victim == camera_id || record_scheduler.over_share(victim);
+        });
+        if (slot < 0) {
+            record_dropped_newest[camera_id].fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+        int victim = record_slots[slot].camera_id;
+        record_dropped_oldest[victim].fetch_add(1, std::memory_order_relaxed);
+        record_scheduler.released(victim);
+        record_scheduler.acquired(camera_id);
+        return slot;
+    }
+    case RecordPolicy::DropNewest:
+        record_dropped_newest[camera_id].fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    return -1;
+}
+
+// 把录制线程写完的槽归还帧池，只有在有采集线程等待时才加锁通知
+void release_record_slot(int slot) {
+    record_scheduler.released(record_slots[slot].camera_id);
+    record_pool.release(slot);
+    if (record_free_waiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(record_mutex);
+        record_free_cv.notify_all();
+    }
+}
 
-    // 请求缓冲区
-    struct v4l2_requestbuffers req;
-    memset(&req, 0, sizeof(req));
-    req.count = 1;
-    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    req.memory = V4L2_MEMORY_MMAP;
-    if (ioctl(fds[camera_id], VIDIOC_REQBUFS, &req) == -1) {
-        std::cerr << "请求缓冲区失败：" << device << " - " << strerror(errno) << std::endl;
-        close(fds[camera_id]);
+// 把当前帧复制到帧池中的空闲槽，交给录制线程写盘
+void record_frame(int camera_id, const BufferLease& lease) {
+    int slot = acquire_record_slot(camera_id);
+    if (slot < 0) {
         return;
     }
 
-    // 映射缓冲区
-    struct v4l2_buffer &buf = buffers[camera_id];
-    memset(&buf, 0, sizeof(buf));
-    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    buf.memory = V4L2_MEMORY_MMAP;
-    buf.index = 0;
-    if (ioctl(fds[camera_id], VIDIOC_QUERYBUF, &buf) == -1) {
-        std::cerr << "查询缓冲区失败：" << device << " - " << strerror(errno) << std::endl;
-        close(fds[camera_id]);
+    // 槽已被本线程独占，复制时不需要持锁
+    RecordSlot& s = record_slots[slot];
+    s.size = std::min(lease.size(), record_pool.slot_size() - record_header_block);
+    memcpy(record_pool.data(slot) + record_header_block, lease.data(), s.size);
+    s.camera_id = camera_id;
+    s.session = record_session.load();
+    s.sequence = lease.sequence();
+    s.timestamp_us = lease.timestamp_us();
+
+    record_queue.push(slot, camera_id);
+    recorder_waker.notify();
+}
+
+// 录制写盘完成：统计并归还帧池槽
+void on_record_written(const WriteJob& job, ssize_t result) {
+    int slot = static_cast<int>(job.tag);
+    int camera_id = record_slots[slot].camera_id;
+    if (result == static_cast<ssize_t>(job.size)) {
+        recorded_frames[camera_id].fetch_add(1, std::memory_order_relaxed);
+        bytes_written[camera_id].fetch_add(job.size, std::memory_order_relaxed);
+        record_latency_ns[camera_id].record((monotonic_now_us() - record_slots[slot].timestamp_us) * 1000);
+    } else {
+        std::cerr << "相机 " << camera_id << " 录制写盘失败：" << strerror(static_cast<int>(-result)) << std::endl;
+    }
+    release_record_slot(slot);
+}
+
+// 录制线程：把帧池中的帧按采集顺序追加到录制容器，实际写盘由写盘后端完成
+void frame_recorder() {
+    apply_thread_placement("recorder", writer_placement);
+    std::unique_ptr<ContainerWriter> container;
+    int container_session = 0;
+    std::string folder_name = "data";
+    create_directory(folder_name);
+
+    while (true) {
+        int slot;
+        if (!record_queue.pop(slot)) {
+            // 相机线程全部退出且队列已清空
+            if (stop_saver.load() && record_queue.empty_approx()) {
+                break;
+            }
+            recorder_waker.wait([] { return !record_queue.empty_approx() || stop_saver.load(); });
+            continue;
+        }
+
+        RecordSlot& s = record_slots[slot];
+        // 新的录制会话写入新容器，旧容器等未完成的写结束后写索引并关闭
+        if (!container || container_session != s.session) {
+            container.reset();
+            std::string prefix = folder_name + "/record_" + std::to_string(std::time(nullptr));
+            container = std::make_unique<ContainerWriter>(record_writer.get(), prefix, segment_bytes);
+            container_session = s.session;
+        }
+
+        // 帧头直接填写在槽的头部，帧头和帧数据一次写出
+        uint8_t* entry = record_pool.data(slot);
+        FramePlacement placement;
+        if (!container->append(make_frame_meta(s.camera_id, s.sequence, s.timestamp_us, s.size), entry, placement)) {
+            release_record_slot(slot);
+            continue;
+        }
+
+        WriteJob job;
+        job.file = placement.file;
+        job.data = entry;
+        job.size = placement.entry_size;
+        job.offset = placement.offset;
+        job.tag = slot;
+        record_writer->submit(job);
+    }
+
+    container.reset();
+}
+
+// 在 trigger_us（CLOCK_MONOTONIC）触发事件，触发前后的窗口都从这个时刻算起。
+// 触发后窗口内再次触发只延长窗口，仍写入同一个片段
+void trigger_event(int64_t trigger_us) {
+    if (!event_writer) {
+        std::cout << "没有相机启用预触发环（--pretrigger 秒）" << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(event_mutex);
+    int64_t end = trigger_us + static_cast<int64_t>(posttrigger_seconds * 1e6);
+    if (event_id.load() > 0 && trigger_us <= event_end_us.load()) {
+        event_end_us = end;
+        std::cout << "事件 " << event_id.load() << " 延长到 " << posttrigger_seconds << " 秒后" << std::endl;
         return;
     }
+    event_trigger_us = trigger_us;
+    event_end_us = end;
+    int id = event_id.fetch_add(1) + 1;
+    std::cout << "事件 " << id << "：写出触发前的帧和之后 " << posttrigger_seconds << " 秒的帧" << std::endl;
+}
+
+// 把环中一个已钉住的槽交给事件线程，队列容量不小于所有环的槽数，入队不会失败
+void enqueue_event_frame(int camera_id, int slot, int event) {
+    event_queue.try_push(EventFrame{camera_id, slot, event});
+    event_waker.notify();
+}
 
-    buffer_start[camera_id] = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fds[camera_id], buf.m.offset);
-    if (buffer_start[camera_id] == MAP_FAILED) {
-        std::cerr << "内存映射失败：" << device << " - " << strerror(errno) << std::endl;
-        close(fds[camera_id]);
+// 把当前帧复制进预触发环。事件期间第一次处理这个相机时先写出环中触发前窗口内的帧，
+// 之后触发后窗口内的帧复制进环后立即写出
+void pretrigger_frame(int camera_id, const BufferLease& lease) {
+    PretriggerRing& ring = pretrigger_rings[camera_id];
+    int64_t now = monotonic_now_us();
+    int event = event_id.load();
+    bool in_event = event > 0 && now <= event_end_us.load();
+    if (in_event && event_flushed[camera_id] != event) {
+        int64_t since = event_trigger_us.load() - static_cast<int64_t>(camera_configs[camera_id].pretrigger_seconds * 1e6);
+        ring.pin_since(since, [camera_id, event](int slot) { enqueue_event_frame(camera_id, slot, event); });
+        event_flushed[camera_id] = event;
+    }
+
+    int slot = ring.next_slot();
+    if (slot < 0) {
+        if (in_event) {
+            event_dropped[camera_id].fetch_add(1, std::memory_order_relaxed);
+        }
         return;
     }
+    size_t size = std::min(lease.size(), ring.payload_capacity());
+    memcpy(ring.payload(slot), lease.data(), size);
+    ring.commit(slot, size, lease.sequence(), lease.timestamp_us(), now);
+    if (in_event) {
+        ring.pin(slot);
+        enqueue_event_frame(camera_id, slot, event);
+    }
+}
+
+// 事件片段写盘完成：统计并放开预触发环中的槽
+void on_event_written(const WriteJob& job, ssize_t result) {
+    int camera_id = static_cast<int>(job.tag >> 32);
+    int slot = static_cast<int>(job.tag & UINT32_MAX);
+    if (result == static_cast<ssize_t>(job.size)) {
+        event_frames[camera_id].fetch_add(1, std::memory_order_relaxed);
+        bytes_written[camera_id].fetch_add(job.size, std::memory_order_relaxed);
+    } else {
+        std::cerr << "相机 " << camera_id << " 事件片段写盘失败：" << strerror(static_cast<int>(-result)) << std::endl;
+    }
+    pretrigger_rings[camera_id].unpin(slot);
+}
+
+// 事件线程：每个事件写入一个容器，帧头填写在环中槽的头部，帧头和帧数据一次写出。
+// 触发后窗口结束一段时间后关闭容器写入索引；之后才到达的同一事件的帧不再写入
+void event_recorder() {
+    apply_thread_placement("events", writer_placement);
+    std::unique_ptr<ContainerWriter> container;
+    int container_event = 0;
+    int closed_event = 0;
+    uint64_t container_frames = 0;
+    std::string folder_name = "data";
+    create_directory(folder_name);
+
+    auto close_container = [&] {
+        std::string path = container->path();
+        container.reset();
+        closed_event = container_event;
+        std::cout << "事件 " << container_event << " 的片段已写完（" << container_frames << " 帧）：" << path << std::endl;
+    };
+
+    while (true) {
+        EventFrame f;
+        if (!event_queue.try_pop(f)) {
+            if (stop_saver.load() && event_queue.empty_approx()) {
+                break;
+            }
+            if (container && monotonic_now_us() > event_end_us.load() + EVENT_CLOSE_DELAY_US) {
+                close_container();
+                continue;
+            }
+            // 片段打开时定期醒来检查是否可以关闭
+            event_waker.wait([] { return !event_queue.empty_approx() || stop_saver.load(); }, container ? 100 : -1);
+            continue;
+        }
+
+        PretriggerRing& ring = pretrigger_rings[f.camera_id];
+        if (f.event <= closed_event) {
+            event_dropped[f.camera_id].fetch_add(1, std::memory_order_relaxed);
+            ring.unpin(f.slot);
+            continue;
+        }
+        if (!container || container_event != f.event) {
+            if (container) {
+                close_container();
+            }
+            std::string prefix = folder_name + "/event_" + std::to_string(std::time(nullptr));
+            container = std::make_unique<ContainerWriter>(event_writer.get(), prefix, segment_bytes);
+            container_event = f.event;
+            container_frames = 0;
+        }
+
+        const PretriggerRing::Slot& s = ring.slot(f.slot);
+        FramePlacement placement;
+        if (!container->append(make_frame_meta(f.camera_id, s.sequence, s.timestamp_us, s.size), ring.entry(f.slot),
+                               placement)) {
+            ring.unpin(f.slot);
+            continue;
+        }
+        ++container_frames;
+
+        WriteJob job;
+        job.file = placement.file;
+        job.data = ring.entry(f.slot);
+        job.size = placement.entry_size;
+        job.offset = placement.offset;
+        job.tag = static_cast<uint64_t>(f.camera_id) << 32 | static_cast<uint32_t>(f.slot);
+        event_writer->submit(job);
+    }
+
+    if (container) {
+        close_container();
+    }
+}
+
+// 相机实际可用的历史深度
+int history_limit(int camera_id) {
+    return std::max(0, std::min(history_depth, capture_sources[camera_id]->buffer_count() - 2));
+}
+
+// 再借一个缓冲区给保存线程后，驱动中是否仍至少留有一个缓冲区
+bool can_hand_off(int camera_id) {
+    int held_by_saver = leased_buffers[camera_id].load() - static_cast<int>(frame_history[camera_id].size());
+    return held_by_saver + history_limit(camera_id) + 2 <= capture_sources[camera_id]->buffer_count();
+}
 
-    // 启动视频流
-    if (ioctl(fds[camera_id], VIDIOC_STREAMON, &buf.type) == -1) {
-        std::cerr << "启动视频流失败：" << device << " - " << strerror(errno) << std::endl;
-        munmap(buffer_start[camera_id], buf.length);
-        close(fds[camera_id]);
+// 把缓冲区交给保存线程，写盘完成后由其重新入队。队列满时缓冲区直接归还驱动，这个相机的请求以失败结束
+void enqueue_for_saving(BufferLease&& lease, std::shared_ptr<SnapshotJob>&& job) {
+    int camera_id = lease.camera_id();
+    SaveRequest request{std::move(lease), std::move(job)};
+    if (!image_queue.try_push(std::move(request))) {
+        std::cerr << "保存队列已满，相机 " << camera_id << " 的帧没有保存" << std::endl;
+        request.lease.release();
+        request.job->finish(camera_id, false, monotonic_now_us());
         return;
     }
+    saver_waker.notify();
+}
+
+// 按顺序满足相机的快照请求，一帧只满足一个请求，驱动缓冲区不足时推迟到下一帧
+void serve_snapshot_jobs(int camera_id, uint32_t sequence) {
+    std::deque<std::shared_ptr<SnapshotJob>>& jobs = snapshot_jobs[camera_id];
+    std::shared_ptr<SnapshotJob> job;
+    while (snapshot_requests[camera_id].try_pop(job)) {
+        jobs.push_back(std::move(job));
+    }
+
+    std::deque<BufferLease>& history = frame_history[camera_id];
+    auto it = jobs.begin();
+    while (it != jobs.end() && !history.empty() && can_hand_off(camera_id)) {
+        int64_t target = (*it)->target_us();
+        std::deque<BufferLease>::iterator picked;
+        if (target > 0) {
+            // 同步快照：最新帧越过目标时刻后，从历史中选出时间戳最接近的一帧。
+            // 目标还没到时跳过，不挡住后面的请求
+            if (history.back().timestamp_us() < target) {
+                ++it;
+                continue;
+            }
+            picked = std::min_element(history.begin(), history.end(), [target](const BufferLease& a, const BufferLease& b) {
+                return std::abs(a.timestamp_us() - target) < std::abs(b.timestamp_us() - target);
+            });
+        } else {
+            // 普通快照按顺序取当前帧，当前帧已经被前面的请求取走时等下一帧
+            if (history.back().sequence() != sequence) {
+                ++it;
+                continue;
+            }
+            picked = std::prev(history.end());
+        }
+
+        SnapshotJob::CameraResult& result = (*it)->result(camera_id);
+        result.sequence = picked->sequence();
+        result.timestamp_us = picked->timestamp_us();
+        result.handed_off_us = monotonic_now_us();
+        BufferLease lease = std::move(*picked);
+        history.erase(picked);
+        enqueue_for_saving(std::move(lease), std::move(*it));
+        it = jobs.erase(it);
+    }
+}
 
-    // 将缓冲区放入队列
-    if (ioctl(fds[camera_id], VIDIOC_QBUF, &buf) == -1) {
-        std::cerr << "缓冲区入队失败：" << device << " - " << strerror(errno) << std::endl;
-        munmap(buffer_start[camera_id], buf.length);
-        close(fds[camera_id]);
+// 按刷新率上限把需要预览的相机的帧复制进它的预览信箱。预览线程正在取帧不影响写入
+void publish_preview(int camera_id, const BufferLease& lease) {
+    bool mosaic = preview_mosaic.load(std::memory_order_relaxed);
+    if (!mosaic && camera_id != preview_camera.load(std::memory_order_relaxed)) {
+        return;
+    }
+    int64_t timestamp = lease.timestamp_us();
+    if (timestamp < preview_next_us[camera_id].load(std::memory_order_relaxed)) {
         return;
     }
+    LatestMailbox<PreviewFrame>& mailbox = preview_mailboxes[camera_id];
+    const v4l2_pix_format& fmt = frame_format[camera_id];
+    PreviewFrame frame;
+    frame.camera_id = camera_id;
+    frame.sequence = lease.sequence();
+    frame.pixelformat = fmt.pixelformat;
+    frame.width = fmt.width;
 
-    fd_set fds_set;
-    struct timeval tv;
+    if (fmt.pixelformat == V4L2_PIX_FMT_MJPEG) {
+        if (lease.size() > mailbox.slot_size()) {
+            return;
+        }
+        uint8_t* slot = mailbox.try_begin_write();
+        if (slot == nullptr) {
+            return;
+        }
+        memcpy(slot, lease.data(), lease.size());
+        frame.height = fmt.height;
+        frame.size = lease.size();
+        mailbox.publish(frame);
+        preview_next_us[camera_id].store(timestamp + 1000000 / preview_fps, std::memory_order_relaxed);
+        return;
+    }
+    if (fmt.pixelformat != V4L2_PIX_FMT_YUYV) {
+        return;
+    }
+    uint32_t rows = std::min<uint32_t>(mosaic ? MOSAIC_TILE_HEIGHT : PREVIEW_HEIGHT, fmt.height);
+    size_t row_bytes = static_cast<size_t>(fmt.width) * 2;
+    if (row_bytes * rows > mailbox.slot_size() || lease.size() < static_cast<size_t>(fmt.bytesperline) * fmt.height) {
+        return;
+    }
+    uint8_t* slot = mailbox.try_begin_write();
+    if (slot == nullptr) {
+        return;
+    }
+    // 与 yuyv_to_bgr_downscale 相同的最近邻行选取，缩小时用不到的行不复制
+    for (uint32_t y = 0; y < rows; ++y) {
+        uint32_t src_row = static_cast<uint32_t>((2ULL * y + 1) * fmt.height / (2ULL * rows));
+        memcpy(slot + y * row_bytes, lease.data() + static_cast<size_t>(src_row) * fmt.bytesperline, row_bytes);
+    }
+    frame.height = rows;
+    frame.bytesperline = static_cast<uint32_t>(row_bytes);
+    mailbox.publish(frame);
+    preview_next_us[camera_id].store(timestamp + 1000000 / preview_fps, std::memory_order_relaxed);
+}
 
+// 取出相机所有已就绪的帧并处理。返回 Empty 表示已取完，End 表示回放结束，Error 表示出现不可恢复的错误
+CaptureSource::Result handle_camera_frames(int camera_id) {
+    CaptureSource& source = *capture_sources[camera_id];
+    CapturedFrame buf;
     while (!exit_program.load()) {
-        auto start_time = std::chrono::high_resolution_clock::now();
+        // 从采集源取出缓冲区，没有就绪的帧时返回
+        CaptureSource::Result result = source.dequeue(buf);
+        if (result != CaptureSource::Result::Frame) {
+            return result;
+        }
+        BufferLease lease(camera_id, buf);
+        last_frame_time[camera_id] = std::chrono::steady_clock::now();
+
+        // 同步快照依赖单调时钟时间戳
+        if (last_sequence[camera_id] < 0 && !buf.monotonic) {
+            std::cerr << "相机 " << camera_id << " 的时间戳不是单调时钟，同步快照可能不准确" << std::endl;
+        }
 
-        FD_ZERO(&fds_set);
-        FD_SET(fds[camera_id], &fds_set);
+        // 根据驱动的帧序号统计丢帧
+        captured_frames[camera_id].fetch_add(1, std::memory_order_relaxed);
+        if (last_sequence[camera_id] >= 0 && buf.sequence > last_sequence[camera_id] + 1) {
+            dropped_frames[camera_id].fetch_add(buf.sequence - last_sequence[camera_id] - 1, std::memory_order_relaxed);
+        }
+        last_sequence[camera_id] = buf.sequence;
+        record_frame_timing(camera_id, buf.timestamp_us);
 
-        tv.tv_sec = 2;
-        tv.tv_usec = 0;
+        // 所选相机的画面交给预览线程
+        publish_preview(camera_id, lease);
 
-        int r = select(fds[camera_id] + 1, &fds_set, NULL, NULL, &tv);
-        if (r == -1) {
-            std::cerr << "select错误：" << strerror(errno) << std::endl;
-            break;
-        } else if (r == 0) {
-            std::cerr << "select超时。" << std::endl;
+        // 连续录制模式下每一帧都写盘
+        if (recording.load()) {
+            record_frame(camera_id, lease);
+        }
+
+        // 复制进预触发环，事件期间同时写出
+        if (pretrigger_rings[camera_id].capacity() > 0) {
+            pretrigger_frame(camera_id, lease);
+        }
+
+        std::deque<BufferLease>& history = frame_history[camera_id];
+        history.push_back(std::move(lease));
+
+        // 快照请求按顺序取这一帧或历史中的帧
+        serve_snapshot_jobs(camera_id, buf.sequence);
+
+        // 超出历史深度的帧归还给驱动
+        while (history.size() > static_cast<size_t>(history_limit(camera_id))) {
+            history.pop_front();
+        }
+    }
+    return CaptureSource::Result::Empty;
+}
+
+// epoll事件中标记退出eventfd和/dev监视的值，其余值为相机编号
+constexpr uint32_t EXIT_EVENT_TAG = UINT32_MAX;
+constexpr uint32_t DEVICE_EVENT_TAG = UINT32_MAX - 1;
+
+// 掉线的相机，由所属的采集反应器定期尝试重新连接
+struct LostCamera {
+    int camera_id = -1;
+    bool was_streaming = false;  // 运行中掉线；启动时就没有打开的相机为false
+    std::chrono::steady_clock::time_point lost_at;
+    bool found = false;          // 设备节点已重新出现
+    std::chrono::steady_clock::time_point found_at;
+};
+
+// 查找相机当前的设备节点。USB相机复位或重新插入后节点编号可能变化，按配置重新匹配。
+// 掉线期间每次重试都会调用，打不开的节点启动时已经报告过，这里不再输出
+bool locate_camera_device(int camera_id) {
+    CameraConfig& config = camera_configs[camera_id];
+    if (!uses_device(config)) {
+        return true;
+    }
+    if (config.match_key == "device") {
+        config.device = config.match_value;
+        return access(config.device.c_str(), F_OK) == 0;
+    }
+    return resolve_camera_device(config, discover_devices(false));
+}
+
+// 打开相机并注册到epoll
+bool start_camera(int epoll_fd, int camera_id) {
+    if (!open_camera(camera_id)) {
+        return false;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = camera_id;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, capture_sources[camera_id]->fd(), &ev) == -1) {
+        std::cerr << "注册相机 " << camera_id << " 到epoll失败：" << strerror(errno) << std::endl;
+        close_camera(camera_id);
+        return false;
+    }
+    return true;
+}
+
+// 相机掉线：移出epoll集合，等借出的缓冲区归还后解除映射并关闭设备，之后等待重连
+void lose_camera(int epoll_fd, int camera_id, std::vector<int>& active, std::vector<LostCamera>& lost) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, capture_sources[camera_id]->fd(), NULL);
+    close_camera(camera_id);
+    active.erase(std::find(active.begin(), active.end(), camera_id));
+
+    LostCamera camera;
+    camera.camera_id = camera_id;
+    camera.was_streaming = true;
+    camera.lost_at = std::chrono::steady_clock::now();
+    lost.push_back(camera);
+    ++reconnect_stats[camera_id].losses;
+    std::cerr << "相机 " << camera_id << " 掉线，等待重新连接" << std::endl;
+}
+
+// 回放结束：关闭采集源，不再重连
+void finish_camera(int epoll_fd, int camera_id, std::vector<int>& active) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, capture_sources[camera_id]->fd(), NULL);
+    close_camera(camera_id);
+    active.erase(std::find(active.begin(), active.end(), camera_id));
+    std::cout << "相机 " << camera_id << " 回放结束：" << camera_device(camera_id) << std::endl;
+    if (finished_cameras.fetch_add(1) + 1 == num_cameras) {
+        std::cout << "所有相机的回放都已结束，按 q 退出" << std::endl;
+    }
+}
+
+// 尝试重新打开掉线的相机，成功的移回 active
+void reconnect_cameras(int epoll_fd, std::vector<int>& active, std::vector<LostCamera>& lost) {
+    for (auto it = lost.begin(); it != lost.end();) {
+        auto now = std::chrono::steady_clock::now();
+        if (!locate_camera_device(it->camera_id)) {
+            it->found = false;
+            ++it;
+            continue;
+        }
+        if (!it->found) {
+            it->found = true;
+            it->found_at = now;
+        }
+        if (!start_camera(epoll_fd, it->camera_id)) {
+            ++it;
             continue;
         }
 
-        // 从队列中取出缓冲区
-        if (ioctl(fds[camera_id], VIDIOC_DQBUF, &buf) == -1) {
-            std::cerr << "缓冲区出队失败：" << device << " - " << strerror(errno) << std::endl;
+        now = std::chrono::steady_clock::now();
+        if (it->was_streaming) {
+            ReconnectStats& stats = reconnect_stats[it->camera_id];
+            int64_t outage = std::chrono::duration_cast<std::chrono::microseconds>(now - it->lost_at).count();
+            int64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(now - it->found_at).count();
+            ++stats.reconnects;
+            stats.total_outage_us += outage;
+            stats.max_outage_us = std::max(stats.max_outage_us, outage);
+            stats.max_latency_us = std::max(stats.max_latency_us, latency);
+            std::cout << "相机 " << it->camera_id << " 已重新连接：" << camera_device(it->camera_id) << "，中断 "
+                      << outage / 1000 << " ms，设备出现后 " << latency / 1000 << " ms 恢复采集" << std::endl;
+        } else {
+            std::cout << "相机 " << it->camera_id << " 已连接：" << camera_device(it->camera_id) << std::endl;
+        }
+        active.push_back(it->camera_id);
+        it = lost.erase(it);
+    }
+}
+
+// 采集反应器：用一个epoll集合管理若干相机，哪个相机就绪就处理哪个。
+// 相机出错（ENODEV/EIO 等）、报告 EPOLLERR/EPOLLHUP 或长时间不出帧时视为掉线，
+// 释放缓冲区后等待重连：/dev 下有节点创建或属性变化时立即重试，否则每秒重试一次
+void capture_reactor(int reactor_id, std::vector<int> camera_ids) {
+    ThreadPlacement placement = capture_placement;
+    if (!placement.cpus.empty()) {
+        placement.cpus = {capture_placement.cpus[reactor_id % capture_placement.cpus.size()]};
+    }
+    apply_thread_placement("capture" + std::to_string(reactor_id), placement);
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        std::cerr << "创建epoll失败：" << strerror(errno) << std::endl;
+        return;
+    }
+
+    // 退出事件，request_exit() 写入后唤醒epoll_wait
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = EXIT_EVENT_TAG;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, exit_event_fd, &ev);
+
+    // 监视 /dev，udev 创建设备节点并设置权限后唤醒重连
+    int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd == -1 || inotify_add_watch(inotify_fd, "/dev", IN_CREATE | IN_ATTRIB) == -1) {
+        std::cerr << "监视/dev失败，改为定时重连：" << strerror(errno) << std::endl;
+    } else {
+        ev.data.u32 = DEVICE_EVENT_TAG;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &ev);
+    }
+
+    // 打开本反应器负责的相机，打不开的当作掉线，插上后自动开始采集
+    std::vector<int> active;
+    std::vector<LostCamera> lost;
+    for (int camera_id : camera_ids) {
+        if (start_camera(epoll_fd, camera_id)) {
+            active.push_back(camera_id);
+        } else {
+            LostCamera camera;
+            camera.camera_id = camera_id;
+            lost.push_back(camera);
+        }
+    }
+
+    std::vector<struct epoll_event> events(camera_ids.size() + 2);
+    auto next_retry = std::chrono::steady_clock::now() + RECONNECT_INTERVAL;
+    while (!exit_program.load()) {
+        int timeout_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(RECONNECT_INTERVAL).count());
+        int n = epoll_wait(epoll_fd, events.data(), events.size(), timeout_ms);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "epoll错误：" << strerror(errno) << std::endl;
             break;
         }
 
-        // 如果需要显示第一个相机的画面
-        if (camera_id == 0) {
-            cv::Mat yuyv(FRAME_HEIGHT, FRAME_WIDTH, CV_8UC2, buffer_start[camera_id]);
-            cv::Mat bgr;
-            cv::cvtColor(yuyv, bgr, cv::COLOR_YUV2BGR_YUYV);
-            cv::Mat resized_bgr;
-            cv::resize(bgr, resized_bgr, cv::Size(640, 480));
-            cv::imshow("Video0 Live Feed", resized_bgr);
+        bool devices_changed = false;
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.u32 == EXIT_EVENT_TAG) {
+                continue;
+            }
+            if (events[i].data.u32 == DEVICE_EVENT_TAG) {
+                char buffer[4096];
+                while (read(inotify_fd, buffer, sizeof(buffer)) > 0) {
+                }
+                devices_changed = true;
+                continue;
+            }
+            int camera_id = static_cast<int>(events[i].data.u32);
+            CaptureSource::Result result = (events[i].events & (EPOLLERR | EPOLLHUP)) ? CaptureSource::Result::Error
+                                                                                       : handle_camera_frames(camera_id);
+            if (result == CaptureSource::Result::Error) {
+                // 这个相机出错，其他相机继续采集
+                lose_camera(epoll_fd, camera_id, active, lost);
+            } else if (result == CaptureSource::Result::End) {
+                finish_camera(epoll_fd, camera_id, active);
+            }
+        }
+
+        // 长时间没有出帧的相机（例如USB挂死）重新连接。回放和合成源没有设备可以挂死，
+        // 回放中录制的帧间隔可以超过超时时间，不做检查
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < active.size();) {
+            int camera_id = active[i];
+            if (uses_device(camera_configs[camera_id]) && now - last_frame_time[camera_id] > STALL_TIMEOUT) {
+                std::cerr << "相机 " << camera_id << " 超时。" << std::endl;
+                lose_camera(epoll_fd, camera_id, active, lost);
+            } else {
+                ++i;
+            }
+        }
+
+        if (!lost.empty() && !exit_program.load() && (devices_changed || now >= next_retry)) {
+            reconnect_cameras(epoll_fd, active, lost);
+            next_retry = std::chrono::steady_clock::now() + RECONNECT_INTERVAL;
+        }
+    }
+
+    for (int camera_id : active) {
+        close_camera(camera_id);
+    }
+    if (inotify_fd != -1) {
+        close(inotify_fd);
+    }
+    close(epoll_fd);
+}
+
+// 快照写盘完成：帧头块和帧数据都写完后归还缓冲区和帧头槽，同步到磁盘后完成快照请求
+void on_snapshot_written(const WriteJob& job, ssize_t result) {
+    PendingSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_mutex);
+        auto it = pending_snapshots.find(job.tag);
+        if (result != static_cast<ssize_t>(job.size)) {
+            std::cerr << "保存相机 " << it->second.lease.camera_id() << " 的图像失败：" << it->second.path
+                      << " - " << strerror(static_cast<int>(-result)) << std::endl;
+            it->second.failed = true;
+        } else {
+            bytes_written[it->second.lease.camera_id()].fetch_add(job.size, std::memory_order_relaxed);
+        }
+        if (--it->second.remaining > 0) {
+            return;
+        }
+        snapshot = std::move(it->second);
+        pending_snapshots.erase(it);
+    }
+    int camera_id = snapshot.lease.camera_id();
+    int64_t now = monotonic_now_us();
+    snapshot_latency_ns[camera_id].record((now - snapshot.lease.timestamp_us()) * 1000);
+    snapshot.lease.release();
+    snapshot_headers.release(snapshot.header_slot);
+    // 帧数据落盘后请求才算完成，O_DIRECT 写的数据也可能还在磁盘缓存中
+    if (!snapshot.failed && fdatasync(job.file.fd) == -1) {
+        std::cerr << "同步快照到磁盘失败：" << snapshot.path << " - " << strerror(errno) << std::endl;
+        snapshot.failed = true;
+    }
+    snapshot.job->result(camera_id).path = snapshot.path;
+    snapshot.job->finish(camera_id, !snapshot.failed, monotonic_now_us());
+}
+
+// 图像保存线程函数：把快照追加到快照容器，帧数据直接从V4L2缓冲区写出
+void image_saver() {
+    apply_thread_placement("saver", writer_placement);
+    std::string folder_name = "data";
+    create_directory(folder_name);
+    std::unique_ptr<ContainerWriter> container;
+    uint64_t next_tag = 0;
 
-            if (cv::waitKey(1) == 'q') {
-                exit_program = true;
+    while (true) {
+        SaveRequest request;
+        if (!image_queue.try_pop(request)) {
+            // 相机线程全部退出且队列已清空
+            if (stop_saver.load() && image_queue.empty_approx()) {
                 break;
             }
+            saver_waker.wait([] { return !image_queue.empty_approx() || stop_saver.load(); });
+            continue;
         }
+        BufferLease& lease = request.lease;
+        int camera_id = lease.camera_id();
 
-        // 检查是否需要保存图像
-        if (capture_images.load() && !camera_saved[camera_id].load()) {
-            // 复制当前帧数据到缓冲区
-            std::vector<uint8_t> frame_data(buf.bytesused);
-            memcpy(frame_data.data(), buffer_start[camera_id], buf.bytesused);
+        // 第一次保存时才创建快照容器
+        if (!container) {
+            std::string prefix = folder_name + "/snapshot_" + std::to_string(std::time(nullptr));
+            container = std::make_unique<ContainerWriter>(snapshot_writer.get(), prefix, segment_bytes);
+            snapshot_headers.init(image_queue.capacity(), container->header_block(), container->alignment());
+        }
 
-            // 将帧数据加入队列
-            {
-                std::lock_guard<std::mutex> lock(queue_mutex);
-                image_queue.emplace(camera_id, std::move(frame_data));
+        // 帧头槽数量等于保存队列容量，不会用完
+        int header_slot = snapshot_headers.acquire();
+        FramePlacement placement;
+        if (header_slot < 0 ||
+            !container->append(make_frame_meta(camera_id, lease.sequence(), lease.timestamp_us(), lease.size()),
+                               snapshot_headers.data(header_slot), placement)) {
+            if (header_slot >= 0) {
+                snapshot_headers.release(header_slot);
             }
-            queue_cv.notify_one();
+            lease.release();
+            request.job->finish(camera_id, false, monotonic_now_us());
+            continue;
+        }
+
+        WriteJob header_job;
+        header_job.file = placement.file;
+        header_job.data = snapshot_headers.data(header_slot);
+        header_job.size = container->header_block();
+        header_job.offset = placement.offset;
+        header_job.tag = next_tag++;
 
-            // 设置已保存标志
-            camera_saved[camera_id] = true;
+        // 按对齐长度写出帧数据，超出V4L2缓冲区时只写实际长度
+        WriteJob payload_job = header_job;
+        payload_job.data = lease.data();
+        payload_job.size = container->padded_payload(lease.size());
+        if (payload_job.size > lease.capacity()) {
+            payload_job.size = lease.size();
         }
+        payload_job.offset = placement.offset + container->header_block();
 
-        // 将缓冲区重新放入队列
-        if (ioctl(fds[camera_id], VIDIOC_QBUF, &buf) == -1) {
-            std::cerr << "缓冲区重新入队失败：" << device << " - " << strerror(errno) << std::endl;
-            break;
+        {
+            std::lock_guard<std::mutex> lock(snapshot_mutex);
+            pending_snapshots[header_job.tag] =
+                PendingSnapshot{std::move(lease), std::move(request.job), header_slot, 2, false, container->path()};
         }
+        snapshot_writer->submit(header_job);
+        snapshot_writer->submit(payload_job);
+    }
+
+    container.reset();
+}
 
-        auto end_time = std::chrono::high_resolution_clock::now();
-        std::chrono::milliseconds frame_duration(30);
-        std::this_thread::sleep_until(start_time + frame_duration);
+// 快照请求完成：报告每个相机选中的帧、写盘耗时和相机之间的时间差，同步快照另外报告相对目标时刻的偏差
+void on_snapshot_job_done(const SnapshotJob& job) {
+    const char* kind = job.target_us() > 0 ? "同步快照 " : "快照 ";
+    int expected = 0;
+    int saved = 0;
+    int64_t min_ts = INT64_MAX;
+    int64_t max_ts = INT64_MIN;
+    for (int i = 0; i < job.camera_count(); ++i) {
+        const SnapshotJob::CameraResult& result = job.result(i);
+        if (!result.expected) {
+            continue;
+        }
+        ++expected;
+        if (!result.saved) {
+            std::cerr << kind << job.id() << "：相机 " << i << " 没有保存" << std::endl;
+            continue;
+        }
+        ++saved;
+        std::cout << kind << job.id() << "：相机 " << i << " 帧序号 " << result.sequence;
+        if (job.target_us() > 0) {
+            std::cout << "，偏差 " << (result.timestamp_us - job.target_us()) << " us";
+        }
+        std::cout << "，写盘并同步 " << (result.completed_us - result.handed_off_us) << " us：" << result.path << std::endl;
+        min_ts = std::min(min_ts, result.timestamp_us);
+        max_ts = std::max(max_ts, result.timestamp_us);
+    }
+    if (saved > 0) {
+        snapshot_job_ns.record((job.completed_us() - job.requested_us()) * 1000);
     }
+    std::cout << kind << job.id() << " 完成：保存 " << saved << "/" << expected << " 个相机，请求到落盘 "
+              << (job.completed_us() - job.requested_us()) << " us";
+    if (min_ts <= max_ts) {
+        std::cout << "，最大时间差 " << (max_ts - min_ts) << " us";
+    }
+    std::cout << std::endl;
+}
 
-    // 停止视频流
-    if (ioctl(fds[camera_id], VIDIOC_STREAMOFF, &buf.type) == -1) {
-        std::cerr << "停止视频流失败：" << device << " - " << strerror(errno) << std::endl;
+// 提交快照请求，正在采集的相机各保存一帧，不等待。target_us 为0时取之后的下一帧，
+// 否则取驱动时间戳最接近它的一帧（同步快照）
+void submit_snapshot(int64_t requested_us, int64_t target_us) {
+    std::vector<int> cameras;
+    for (int i = 0; i < num_cameras; ++i) {
+        if (camera_streaming[i].load()) {
+            cameras.push_back(i);
+        }
+    }
+    if (cameras.empty()) {
+        std::cout << "没有正在采集的相机，快照被忽略" << std::endl;
+        return;
+    }
+    auto job = std::make_shared<SnapshotJob>(snapshot_job_id.fetch_add(1) + 1, requested_us, target_us, num_cameras,
+                                             cameras, on_snapshot_job_done);
+    for (int camera_id : cameras) {
+        std::shared_ptr<SnapshotJob> request = job;
+        if (!snapshot_requests[camera_id].try_push(std::move(request))) {
+            std::cerr << "相机 " << camera_id << " 排队的快照请求太多，这次不保存它的帧" << std::endl;
+            job->finish(camera_id, false, monotonic_now_us());
+        }
     }
+}
 
-    // 释放资源
-    munmap(buffer_start[camera_id], buf.length);
-    close(fds[camera_id]);
+// 把信箱中的帧转换缩小到 target（可以是画布中的一块区域）并标上相机编号，MJPEG 帧损坏时返回false
+bool draw_preview(const uint8_t* data, const PreviewFrame& frame, cv::Mat& target, MjpegDecoder& decoder) {
+    if (frame.pixelformat == V4L2_PIX_FMT_MJPEG) {
+        if (!decoder.decode(data, frame.size, target.ptr<uint8_t>(), target.cols, target.rows, target.step)) {
+            return false;
+        }
+    } else {
+        yuyv_to_bgr_downscale(data, frame.width, frame.height, frame.bytesperline,
+                              target.ptr<uint8_t>(), target.cols, target.rows, target.step);
+    }
+    cv::putText(target, "Camera " + std::to_string(frame.camera_id), cv::Point(10, 30),
+                cv::FONT_HERSHEY_SIMPLEX, 0.8, cv::Scalar(0, 255, 0), 2);
+    return true;
 }
 
-// 图像保存线程函数
-void image_saver() {
+// 预览线程：取出信箱中的最新帧，转换缩小后显示。窗口中按 q 退出，按数字键切换相机，按 m 切换拼接预览。
+// 拼接预览共用一块预先分配的画布，只重画收到新帧的相机所在的格子
+void preview_display() {
+    apply_thread_placement("preview", preview_placement);
+    cv::Mat preview(PREVIEW_HEIGHT, PREVIEW_WIDTH, CV_8UC3);
+    int mosaic_rows = (num_cameras + MOSAIC_COLUMNS - 1) / MOSAIC_COLUMNS;
+    cv::Mat canvas(mosaic_rows * MOSAIC_TILE_HEIGHT, MOSAIC_COLUMNS * MOSAIC_TILE_WIDTH, CV_8UC3, cv::Scalar(0, 0, 0));
+    std::vector<cv::Mat> tiles;
+    for (int i = 0; i < num_cameras; ++i) {
+        cv::Rect area((i % MOSAIC_COLUMNS) * MOSAIC_TILE_WIDTH, (i / MOSAIC_COLUMNS) * MOSAIC_TILE_HEIGHT,
+                      MOSAIC_TILE_WIDTH, MOSAIC_TILE_HEIGHT);
+        tiles.push_back(canvas(area));
+    }
+
+    MjpegDecoder decoder;
+    bool shown = false;
     while (!exit_program.load()) {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        queue_cv.wait(lock, [] { return !image_queue.empty() || exit_program.load(); });
+        const uint8_t* data = nullptr;
+        PreviewFrame frame;
+        bool updated = false;
+        if (preview_mosaic.load()) {
+            for (int i = 0; i < num_cameras; ++i) {
+                if (preview_mailboxes[i].take(data, frame) && draw_preview(data, frame, tiles[i], decoder)) {
+                    updated = true;
+                }
+            }
+            if (updated) {
+                cv::imshow("Live Feed", canvas);
+            }
+        } else if (preview_mailboxes[preview_camera.load()].take(data, frame) &&
+                   draw_preview(data, frame, preview, decoder)) {
+            cv::imshow("Live Feed", preview);
+            updated = true;
+        }
+        shown = shown || updated;
 
-        while (!image_queue.empty()) {
-            auto [camera_id, frame_data] = std::move(image_queue.front());
-            image_queue.pop();
-            lock.unlock();
+        // 窗口还没有出现时 waitKey 可能立即返回，改为休眠
+        if (!shown) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        int key = cv::waitKey(5);
+        if (key == 'q') {
+            request_exit();
+        } else if (key >= '0' && key < '0' + std::min(num_cameras, 10)) {
+            preview_camera.store(key - '0');
+            preview_mosaic.store(false);
+            preview_next_us[key - '0'].store(0);
+            std::cout << "预览切换到相机 " << key - '0' << std::endl;
+        } else if (key == 'm') {
+            bool mosaic = !preview_mosaic.load();
+            preview_mosaic.store(mosaic);
+            for (auto& next : preview_next_us) {
+                next.store(0);
+            }
+            std::cout << (mosaic ? "切换到拼接预览" : "切换到单相机预览") << std::endl;
+        }
+    }
+    cv::destroyAllWindows();
+}
 
-            // 创建目录
-            std::string folder_name = "data";
-            create_directory(folder_name);
+// 生成 Prometheus 文本格式的指标
+std::string render_metrics() {
+    PrometheusText text;
+    auto camera_label = [](int i) { return "camera=\"" + std::to_string(i) + "\""; };
 
-            // 保存图像
-            std::string filename = folder_name + "/camera_" + std::to_string(camera_id) + "_" + std::to_string(std::time(nullptr)) + ".yuyv";
-            std::ofstream out_file(filename, std::ios::binary);
-            out_file.write(reinterpret_cast<char*>(frame_data.data()), frame_data.size());
-            std::cout << "保存了相机 " << camera_id << " 的图像：" << filename << std::endl;
+    text.declare("capture_frames_total", "counter", "Frames dequeued from the driver");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_frames_total", camera_label(i), static_cast<double>(captured_frames[i].load(std::memory_order_relaxed)));
+    }
+    text.declare("capture_dropped_frames_total", "counter", "Frames lost according to driver sequence gaps");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_dropped_frames_total", camera_label(i), static_cast<double>(dropped_frames[i].load(std::memory_order_relaxed)));
+    }
+    text.declare("capture_streaming", "gauge", "Whether the camera is currently streaming");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_streaming", camera_label(i), camera_streaming[i].load(std::memory_order_relaxed) ? 1 : 0);
+    }
+    text.declare("capture_leased_buffers", "gauge", "Buffers dequeued and not yet returned to the driver");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_leased_buffers", camera_label(i), leased_buffers[i].load(std::memory_order_relaxed));
+    }
+    text.declare("capture_written_bytes_total", "counter", "Snapshot, recording and event clip bytes written to disk");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_written_bytes_total", camera_label(i), static_cast<double>(bytes_written[i].load(std::memory_order_relaxed)));
+    }
+    text.declare("capture_recorded_frames_total", "counter", "Frames written by continuous recording");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_recorded_frames_total", camera_label(i), static_cast<double>(recorded_frames[i].load(std::memory_order_relaxed)));
+    }
+    text.declare("capture_event_frames_total", "counter", "Frames written to event clips");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_event_frames_total", camera_label(i), static_cast<double>(event_frames[i].load(std::memory_order_relaxed)));
+    }
+    text.declare("capture_event_dropped_frames_total", "counter", "Event clip frames lost because the pre-trigger ring was full");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.value("capture_event_dropped_frames_total", camera_label(i), static_cast<double>(event_dropped[i].load(std::memory_order_relaxed)));
+    }
+    text.declare("capture_buffer_hold_seconds", "histogram", "Time from VIDIOC_DQBUF to VIDIOC_QBUF");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.histogram("capture_buffer_hold_seconds", camera_label(i), buffer_hold_ns[i]);
+    }
+    text.declare("capture_save_latency_seconds", "histogram", "Time from driver timestamp to write completion");
+    for (int i = 0; i < num_cameras; ++i) {
+        text.histogram("capture_save_latency_seconds", camera_label(i) + ",kind=\"snapshot\"", snapshot_latency_ns[i]);
+        text.histogram("capture_save_latency_seconds", camera_label(i) + ",kind=\"record\"", record_latency_ns[i]);
+    }
+    text.declare("capture_snapshot_requests_total", "counter", "Snapshot requests submitted");
+    text.value("capture_snapshot_requests_total", "", static_cast<double>(snapshot_job_id.load(std::memory_order_relaxed)));
+    text.declare("capture_snapshot_request_seconds", "histogram", "Time from a snapshot request until the last camera's frame is synced to disk (requests that saved at least one frame)");
+    text.histogram("capture_snapshot_request_seconds", "", snapshot_job_ns);
 
-            lock.lock();
+    text.declare("capture_queue_depth", "gauge", "Approximate number of queued items");
+    text.value("capture_queue_depth", "queue=\"snapshot\"", static_cast<double>(image_queue.size_approx()));
+    text.value("capture_queue_depth", "queue=\"record\"", static_cast<double>(record_queue.size_approx()));
+    text.declare("capture_record_pool_free", "gauge", "Free slots in the recording frame pool");
+    text.value("capture_record_pool_free", "", static_cast<double>(record_pool.available()));
+    if (record_scheduler.ready()) {
+        text.declare("capture_record_slot_share", "gauge", "Recording pool slots guaranteed to the camera");
+        for (int i = 0; i < num_cameras; ++i) {
+            text.value("capture_record_slot_share", camera_label(i), record_scheduler.share(i));
+        }
+        text.declare("capture_record_slots_in_use", "gauge", "Recording pool slots held by the camera");
+        for (int i = 0; i < num_cameras; ++i) {
+            text.value("capture_record_slots_in_use", camera_label(i), record_scheduler.used(i));
+        }
+        text.declare("capture_record_admitted_total", "counter", "Recording pool slots granted to the camera");
+        for (int i = 0; i < num_cameras; ++i) {
+            text.value("capture_record_admitted_total", camera_label(i),
+                       static_cast<double>(record_scheduler.stats(i).admitted.load(std::memory_order_relaxed)));
         }
+        text.declare("capture_record_throttled_total", "counter", "Frames that found no recording pool slot for the camera");
+        for (int i = 0; i < num_cameras; ++i) {
+            text.value("capture_record_throttled_total", camera_label(i),
+                       static_cast<double>(record_scheduler.stats(i).throttled.load(std::memory_order_relaxed)));
+        }
+        text.declare("capture_record_wait_seconds", "histogram", "Time blocked waiting for a recording pool slot");
+        for (int i = 0; i < num_cameras; ++i) {
+            text.histogram("capture_record_wait_seconds", camera_label(i), record_wait_ns[i]);
+        }
+        text.declare("capture_record_fairness", "gauge", "Jain index of weighted recording pool grants (1 is fair)");
+        text.value("capture_record_fairness", "", record_scheduler.fairness_index());
     }
+    text.declare("capture_control_dispatch_seconds", "histogram", "Time from receiving a control command to dispatching it");
+    text.histogram("capture_control_dispatch_seconds", "", control_server.dispatch_latency());
+    return text.str();
 }
 
-// 键盘监听线程
-void keyboard_listener() {
-    while (!exit_program.load()) {
-        char key = std::cin.get();
-        if (key == 's') {
-            // 重置camera_saved标志
-            for (int i = 0; i < NUM_CAMERAS; ++i) {
-                camera_saved[i] = false;
+// 定期输出每个相机在这一周期内的帧率、丢帧、写盘速度和累计的延迟分位数
+void stats_reporter() {
+    std::vector<uint64_t> last_frames(num_cameras, 0);
+    std::vector<uint64_t> last_dropped(num_cameras, 0);
+    std::vector<uint64_t> last_bytes(num_cameras, 0);
+    struct pollfd exit_poll = {exit_event_fd, POLLIN, 0};
+    // 退出时 exit_event_fd 变为可读，poll 立即返回
+    while (!exit_program.load() && poll(&exit_poll, 1, stats_interval * 1000) == 0) {
+        std::cout << "---- 统计（" << stats_interval << " 秒）：保存队列 " << image_queue.size_approx()
+                  << "，录制队列 " << record_queue.size_approx() << " ----" << std::endl;
+        for (int i = 0; i < num_cameras; ++i) {
+            uint64_t frames = captured_frames[i].load(std::memory_order_relaxed);
+            uint64_t dropped = dropped_frames[i].load(std::memory_order_relaxed);
+            uint64_t bytes = bytes_written[i].load(std::memory_order_relaxed);
+            std::cout << "相机 " << i << "：" << static_cast<double>(frames - last_frames[i]) / stats_interval << " fps，丢帧 "
+                      << dropped - last_dropped[i] << "，写盘 " << (bytes - last_bytes[i]) / 1e6 / stats_interval
+                      << " MB/s，缓冲区占用 p99 " << buffer_hold_ns[i].percentile(99) / 1000 << " us，录制延迟 p99 "
+                      << record_latency_ns[i].percentile(99) / 1000 << " us";
+            if (record_scheduler.ready()) {
+                std::cout << "，帧池占用 " << record_scheduler.used(i) << "/" << record_scheduler.share(i) << " 槽，没有取到槽 "
+                          << record_scheduler.stats(i).throttled.load(std::memory_order_relaxed) << " 次";
             }
+            std::cout << std::endl;
+            last_frames[i] = frames;
+            last_dropped[i] = dropped;
+            last_bytes[i] = bytes;
+        }
+    }
+}
 
-            // 设置capture_images为true
-            capture_images = true;
-
-            // 等待所有相机完成保存
-            bool all_saved = false;
-            while (!all_saved) {
-                all_saved = true;
-                for (int i = 0; i < NUM_CAMERAS; ++i) {
-                    if (!camera_saved[i].load()) {
-                        all_saved = false;
-                        break;
-                    }
-                }
-                if (!all_saved) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+// 控制命令的处理函数，在控制通道的分发线程中调用
+void handle_control_command(const ControlCommand& command) {
+    if (command.source != "stdin") {
+        std::cout << "控制命令：" << command.name << (command.argument.empty() ? "" : " " + command.argument)
+                  << "（" << command.source << "）" << std::endl;
+    }
+    if (command.name == "snapshot") {
+        submit_snapshot(command.received_us, 0);
+    } else if (command.name == "sync") {
+        submit_snapshot(command.received_us, command.timestamp_us);
+    } else if (command.name == "event") {
+        trigger_event(command.timestamp_us);
+    } else if (command.name == "record") {
+        // 不带参数时切换，start/stop 在已经处于该状态时不做任何事
+        if (command.argument.empty() || (command.argument == "start") != recording.load()) {
+            toggle_recording();
+        }
+    } else if (command.name == "stop") {
+        request_exit();
+    }
+}
+
+// 发现设备并生成每个相机的配置，失败时返回false
+bool setup_cameras(const std::string& config_path, const std::vector<std::pair<int, int>>& fps_overrides,
+                   const CameraConfig& offline, int synthetic_cameras) {
+    std::vector<DeviceInfo> devices = discover_devices();
+
+    CameraConfig defaults;
+    defaults.width = DEFAULT_FRAME_WIDTH;
+    defaults.height = DEFAULT_FRAME_HEIGHT;
+    defaults.pixelformat = capture_pixelformat;
+    defaults.fps = default_fps;
+    defaults.buffers = num_buffers;
+    defaults.pretrigger_seconds = pretrigger_seconds;
+    defaults.pretrigger_mb = pretrigger_mb;
+    defaults.replay_max_speed = offline.replay_max_speed;
+    defaults.replay_loop = offline.replay_loop;
+    if (config_path.empty() && offline.match_key == "replay") {
+        // --replay：文件中的每个相机各作为一个相机
+        for (int track : replay_tracks(offline.match_value)) {
+            CameraConfig camera = defaults;
+            camera.match_key = "replay";
+            camera.match_value = offline.match_value;
+            camera.replay_track = track;
+            camera_configs.push_back(camera);
+        }
+        camera_configs.resize(std::min<size_t>(camera_configs.size(), MAX_CAMERAS));
+        resolve_camera_devices(camera_configs, devices);
+    } else if (config_path.empty() && synthetic_cameras > 0) {
+        // --synthetic N：N 个合成相机
+        for (int i = 0; i < std::min(synthetic_cameras, MAX_CAMERAS); ++i) {
+            CameraConfig camera = defaults;
+            camera.match_key = "synthetic";
+            camera.match_value = std::to_string(i);
+            camera_configs.push_back(camera);
+        }
+        resolve_camera_devices(camera_configs, devices);
+    } else if (config_path.empty()) {
+        camera_configs = default_camera_config(devices, defaults, MAX_CAMERAS);
+    } else {
+        if (!load_camera_config(config_path, defaults, camera_configs)) {
+            return false;
+        }
+        if (static_cast<int>(camera_configs.size()) > MAX_CAMERAS) {
+            std::cerr << "配置的相机超过 " << MAX_CAMERAS << " 个，多余的被忽略" << std::endl;
+            camera_configs.resize(MAX_CAMERAS);
+        }
+        resolve_camera_devices(camera_configs, devices);
+    }
+    for (const auto& [camera_id, fps] : fps_overrides) {
+        if (camera_id < static_cast<int>(camera_configs.size())) {
+            camera_configs[camera_id].fps = fps;
+        }
+    }
+
+    // 历史帧不占用驱动的缓冲区份额
+    for (CameraConfig& config : camera_configs) {
+        config.buffers += history_depth;
+    }
+
+    num_cameras = static_cast<int>(camera_configs.size());
+    if (num_cameras == 0) {
+        std::cerr << "没有可用的相机" << std::endl;
+        return false;
+    }
+    for (int i = 0; i < num_cameras; ++i) {
+        const CameraConfig& config = camera_configs[i];
+        if (config.device.empty()) {
+            continue;
+        }
+        if (config.match_key == "replay" && !probe_replay_format(camera_configs[i])) {
+            return false;
+        }
+        std::cout << "相机 " << i << "：" << config.device << " " << config.width << "x" << config.height << " "
+                  << pixelformat_name(config.pixelformat) << " " << config.fps << "fps " << config.buffers << " 个缓冲区（其中历史帧 "
+                  << history_depth << " 个）" << std::endl;
+        if (uses_device(config) && !device_supports(config.device, config.pixelformat, config.width, config.height)) {
+            std::cerr << "相机 " << i << " 的设备没有列出所选的格式或分辨率，驱动可能会调整" << std::endl;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    bool start_recording = false;
+    bool list_devices = false;
+    std::string config_path;
+    std::vector<std::pair<int, int>> fps_overrides;
+    CameraConfig offline;       // --replay 的文件和回放方式，没有配置文件时代替设备发现
+    int synthetic_cameras = 0;  // --synthetic N，没有配置文件时代替设备发现
+    std::vector<std::unique_ptr<ControlSource>> control_sources;
+    bool control_stdin = true;  // --no-stdin 在后台运行时不读标准输入
+
+    // 解析命令行参数
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--buffers" && i + 1 < argc) {
+            num_buffers = std::max(2, std::atoi(argv[++i]));
+        } else if (arg == "--reactors" && i + 1 < argc) {
+            num_reactors = std::clamp(std::atoi(argv[++i]), 1, MAX_CAMERAS);
+        } else if (arg == "--history" && i + 1 < argc) {
+            history_depth = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--fps" && i + 1 < argc) {
+            // --fps N 设置默认帧率，--fps ID:N 覆盖一个相机，在读取配置后生效
+            std::string value = argv[++i];
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                default_fps = std::max(0, std::atoi(value.c_str()));
+            } else {
+                int camera_id = std::atoi(value.substr(0, colon).c_str());
+                if (camera_id >= 0 && camera_id < MAX_CAMERAS) {
+                    fps_overrides.emplace_back(camera_id, std::max(0, std::atoi(value.c_str() + colon + 1)));
                 }
             }
+        } else if (arg == "--record") {
+            start_recording = true;
+        } else if (arg == "--pool-frames" && i + 1 < argc) {
+            record_pool_frames = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--record-policy" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "block") {
+                record_policy = RecordPolicy::Block;
+            } else if (policy == "drop-oldest") {
+                record_policy = RecordPolicy::DropOldest;
+            } else if (policy == "drop-newest") {
+                record_policy = RecordPolicy::DropNewest;
+            } else {
+                std::cerr << "未知的录制策略：" << policy << std::endl;
+                return 1;
+            }
+        } else if (arg == "--writer" && i + 1 < argc) {
+            if (!parse_writer_backend(argv[++i], writer_backend)) {
+                std::cerr << "未知的写盘后端：" << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--writer-threads" && i + 1 < argc) {
+            writer_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--direct") {
+            direct_io = true;
+        } else if (arg == "--segment-mb" && i + 1 < argc) {
+            segment_bytes = static_cast<uint64_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+        } else if (arg == "--preview-camera" && i + 1 < argc) {
+            preview_camera = std::clamp(std::atoi(argv[++i]), 0, MAX_CAMERAS - 1);
+        } else if (arg == "--preview-fps" && i + 1 < argc) {
+            preview_fps = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--format" && i + 1 < argc) {
+            std::string value = argv[++i];
+            capture_pixelformat = parse_pixelformat(value);
+            if (capture_pixelformat == 0) {
+                std::cerr << "未知的采集格式：" << value << std::endl;
+                return 1;
+            }
+        } else if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--stats-interval" && i + 1 < argc) {
+            stats_interval = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--metrics-socket" && i + 1 < argc) {
+            metrics_socket_path = argv[++i];
+        } else if (arg == "--control-socket" && i + 1 < argc) {
+            control_sources.push_back(make_socket_source(argv[++i]));
+        } else if (arg == "--control-fifo" && i + 1 < argc) {
+            control_sources.push_back(make_fifo_source(argv[++i]));
+        } else if (arg == "--gpio-trigger" && i + 1 < argc) {
+            control_sources.push_back(make_gpio_source(argv[++i]));
+        } else if (arg == "--input-trigger" && i + 1 < argc) {
+            control_sources.push_back(make_input_source(argv[++i]));
+        } else if (arg == "--no-stdin") {
+            control_stdin = false;
+        } else if (arg == "--replay" && i + 1 < argc) {
+            offline.match_key = "replay";
+            offline.match_value = argv[++i];
+        } else if (arg == "--replay-speed" && i + 1 < argc) {
+            std::string speed = argv[++i];
+            if (speed != "original" && speed != "max") {
+                std::cerr << "未知的回放速度：" << speed << std::endl;
+                return 1;
+            }
+            offline.replay_max_speed = speed == "max";
+        } else if (arg == "--replay-loop") {
+            offline.replay_loop = true;
+        } else if (arg == "--synthetic" && i + 1 < argc) {
+            synthetic_cameras = std::max(1, std::atoi(argv[++i]));
+        } else if ((arg == "--capture-cpus" || arg == "--writer-cpus" || arg == "--preview-cpus") && i + 1 < argc) {
+            ThreadPlacement& placement = arg == "--capture-cpus"  ? capture_placement
+                                         : arg == "--writer-cpus" ? writer_placement
+                                                                  : preview_placement;
+            std::string error;
+            if (!parse_cpu_set(argv[++i], placement.cpus, error)) {
+                std::cerr << "无效的CPU集合：" << argv[i] << " - " << error << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pretrigger" && i + 1 < argc) {
+            pretrigger_seconds = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--pretrigger-mb" && i + 1 < argc) {
+            pretrigger_mb = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--posttrigger" && i + 1 < argc) {
+            posttrigger_seconds = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--capture-priority" && i + 1 < argc) {
+            capture_placement.rt_priority = std::clamp(std::atoi(argv[++i]), 0, 99);
+        } else if (arg == "--opencv-threads" && i + 1 < argc) {
+            opencv_threads = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--list-devices") {
+            list_devices = true;
+        } else if (arg == "--mosaic") {
+            preview_mosaic = true;
+        } else if (arg == "--no-preview") {
+            preview_enabled = false;
+        } else {
+            std::cerr << "用法：" << argv[0] << " [--buffers N] [--reactors N] [--fps N|ID:N]"
+                      << " [--history N（同步快照的历史帧数，每个相机在 --buffers 之外多申请 N 个缓冲区）]"
+                      << " [--record] [--pool-frames N] [--record-policy block|drop-oldest|drop-newest]"
+                      << " [--writer sync|pool|uring] [--writer-threads N] [--direct] [--segment-mb N]"
+                      << " [--preview-camera N] [--preview-fps N] [--mosaic] [--no-preview]"
+                      << " [--format yuyv|mjpeg] [--config 文件] [--list-devices]"
+                      << " [--stats-interval 秒] [--metrics-socket 路径] [--control-socket 路径] [--control-fifo 路径]"
+                      << " [--gpio-trigger 芯片:线号:边沿:命令] [--input-trigger 设备:按键码:命令] [--no-stdin]"
+                      << " [--replay 分段文件|录制前缀|目录] [--replay-speed original|max] [--replay-loop] [--synthetic N]"
+                      << " [--capture-cpus CPU集合] [--capture-priority N] [--writer-cpus CPU集合]"
+                      << " [--preview-cpus CPU集合] [--opencv-threads N]"
+                      << " [--pretrigger 秒] [--pretrigger-mb N] [--posttrigger 秒]" << std::endl;
+            return 1;
+        }
+    }
 
-            // 重置capture_images
-            capture_images = false;
-        } else if (key == 'q') {
-            exit_program = true;
-            queue_cv.notify_all();  // 通知image_saver线程退出
-            break;
+    if (list_devices) {
+        print_devices(discover_devices());
+        return 0;
+    }
+    if (!setup_cameras(config_path, fps_overrides, offline, synthetic_cameras)) {
+        return 1;
+    }
+    num_reactors = std::min(num_reactors, num_cameras);
+    preview_camera = std::min(preview_camera.load(), num_cameras - 1);
+
+    exit_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (exit_event_fd == -1) {
+        std::cerr << "创建eventfd失败：" << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::cout << "预览转换实现：" << yuyv_kernel_name() << std::endl;
+    if (!capture_placement.cpus.empty()) {
+        std::cout << "采集线程CPU：" << format_cpu_list(capture_placement.cpus) << std::endl;
+    }
+    if (!writer_placement.cpus.empty()) {
+        std::cout << "写盘线程CPU：" << format_cpu_list(writer_placement.cpus) << std::endl;
+    }
+    if (!preview_placement.cpus.empty()) {
+        std::cout << "预览线程CPU：" << format_cpu_list(preview_placement.cpus) << std::endl;
+    }
+    if (opencv_threads >= 0) {
+        cv::setNumThreads(opencv_threads);
+    }
+
+    // 保存队列最多容纳所有相机的全部缓冲区，录制队列最多容纳整个帧池
+    int total_buffers = 0;
+    for (const CameraConfig& config : camera_configs) {
+        total_buffers += config.buffers;
+    }
+    image_queue.init(total_buffers);
+    for (int i = 0; i < num_cameras; ++i) {
+        snapshot_requests[i].init(SNAPSHOT_REQUEST_DEPTH);
+    }
+    // 预览信箱按配置的宽度和最大的预览高度分配，MJPEG 按未压缩帧的一半估计压缩帧上限
+    for (int i = 0; i < num_cameras && preview_enabled; ++i) {
+        const CameraConfig& config = camera_configs[i];
+        size_t slot_size = config.pixelformat == V4L2_PIX_FMT_MJPEG
+                               ? static_cast<size_t>(config.width) * config.height
+                               : static_cast<size_t>(config.width) * 2 * std::max(PREVIEW_HEIGHT, MOSAIC_TILE_HEIGHT);
+        if (!preview_mailboxes[i].init(slot_size)) {
+            std::cerr << "分配预览缓冲区失败" << std::endl;
+            preview_enabled = false;
         }
     }
-}
+    record_queue.init(record_pool_frames);
+
+    // 预触发环按配置的帧率估计槽数：触发前窗口加上写盘余量，实际槽数在打开相机后按帧大小和内存上限确定
+    size_t event_slots = 0;
+    for (int i = 0; i < num_cameras; ++i) {
+        const CameraConfig& config = camera_configs[i];
+        if (config.pretrigger_seconds > 0) {
+            int fps = config.fps > 0 ? config.fps : DEFAULT_FPS;
+            pretrigger_planned_slots[i] = static_cast<size_t>(std::ceil((config.pretrigger_seconds + PRETRIGGER_WRITE_MARGIN) * fps));
+            event_slots += pretrigger_planned_slots[i];
+        }
+    }
+    if (event_slots > 0) {
+        event_queue.init(event_slots);
+    }
+
+    // 创建写盘后端
+    snapshot_writer = create_disk_writer(writer_backend, writer_threads, direct_io, on_snapshot_written,
+                                         [] { apply_thread_placement("snap-writer", writer_placement); });
+    record_writer = create_disk_writer(writer_backend, writer_threads, direct_io, on_record_written,
+                                       [] { apply_thread_placement("rec-writer", writer_placement); });
+
+    if (event_slots > 0) {
+        event_writer = create_disk_writer(writer_backend, writer_threads, direct_io, on_event_written,
+                                          [] { apply_thread_placement("event-writer", writer_placement); });
+    }
 
-int main() {
-    // 初始化camera_saved标志
-    for (int i = 0; i < NUM_CAMERAS; ++i) {
-        camera_saved[i] = false;
+    // --record 在采集开始前打开，最大速度回放的第一帧也会录下
+    if (start_recording) {
+        toggle_recording();
     }
 
-    // 启动相机线程
+    // 启动采集反应器线程，相机按编号轮流分配
+    std::vector<std::vector<int>> reactor_cameras(num_reactors);
+    for (int i = 0; i < num_cameras; ++i) {
+        reactor_cameras[i % num_reactors].push_back(i);
+    }
     std::vector<std::thread> camera_threads;
-    for (int i = 0; i < NUM_CAMERAS; ++i) {
-        camera_threads.emplace_back(capture_camera, i);
+    for (int i = 0; i < num_reactors; ++i) {
+        camera_threads.emplace_back(capture_reactor, i, reactor_cameras[i]);
     }
 
-    // 启动图像保存线程
+    // 启动图像保存线程和录制线程
     std::thread saver_thread(image_saver);
+    std::thread recorder_thread(frame_recorder);
+    std::thread event_thread;
+    if (event_writer) {
+        event_thread = std::thread(event_recorder);
+    }
+
+    // 启动统计输出线程和指标服务
+    std::thread stats_thread;
+    if (stats_interval > 0) {
+        stats_thread = std::thread(stats_reporter);
+    }
+    MetricsServer metrics_server;
+    if (!metrics_socket_path.empty() && metrics_server.start(metrics_socket_path, render_metrics)) {
+        std::cout << "指标服务：" << metrics_socket_path << std::endl;
+    }
 
-    // 启动键盘监听线程
-    std::thread listener_thread(keyboard_listener);
+    // 启动预览线程
+    std::thread preview_thread;
+    if (preview_enabled) {
+        preview_thread = std::thread(preview_display);
+    }
+
+    // 启动控制通道，标准输入和其他来源的命令都由它分发
+    if (control_stdin) {
+        control_server.add(make_stdin_source());
+    }
+    for (auto& source : control_sources) {
+        if (source) {
+            std::cout << "控制来源：" << source->name() << std::endl;
+        }
+        control_server.add(std::move(source));
+    }
+    control_server.start(handle_control_command);
 
     // 等待所有线程完成
     for (auto &t : camera_threads) {
         t.join();
     }
 
-    // 通知image_saver线程退出
+    // 通知image_saver线程和录制线程退出
     exit_program = true;
-    queue_cv.notify_all();
+    stop_saver = true;
+    saver_waker.notify();
+    recorder_waker.notify();
+    event_waker.notify();
     saver_thread.join();
+    recorder_thread.join();
+    if (event_thread.joinable()) {
+        event_thread.join();
+    }
+
+    if (preview_thread.joinable()) {
+        preview_thread.join();
+    }
+    if (stats_thread.joinable()) {
+        stats_thread.join();
+    }
+    metrics_server.stop();
+    control_server.stop();
+    // 采集反应器退出后提交的快照请求没有相机处理，控制通道停止后不会再有新请求
+    for (int i = 0; i < num_cameras; ++i) {
+        fail_snapshot_jobs(i);
+    }
+    close(exit_event_fd);
 
-    listener_thread.join();
+    // 输出写盘后端的吞吐量和延迟
+    snapshot_writer->print_stats();
+    record_writer->print_stats();
+    if (event_writer) {
+        event_writer->print_stats();
+    }
+    snapshot_writer.reset();
+    record_writer.reset();
+    event_writer.reset();
 
-    cv::destroyAllWindows();
+    // 输出每个相机的采集统计
+    for (int i = 0; i < num_cameras; ++i) {
+        uint64_t frames = captured_frames[i].load();
+        double fps = 0.0;
+        if (timed_span_us[i] > 0) {
+            fps = timed_intervals[i] * 1e6 / timed_span_us[i];
+        }
+        std::cout << "相机 " << i << "：采集 " << frames
+                  << " 帧，丢帧 " << dropped_frames[i].load()
+                  << "，实际帧率 " << fps << " fps" << std::endl;
+        std::cout << "  缓冲区占用（DQBUF 到 QBUF）：p50 " << buffer_hold_ns[i].percentile(50) / 1000 << " us，p99 "
+                  << buffer_hold_ns[i].percentile(99) / 1000 << " us，p99.9 "
+                  << buffer_hold_ns[i].percentile(99.9) / 1000 << " us" << std::endl;
+
+        std::cout << "  帧间隔抖动：";
+        for (int b = 0; b < NUM_JITTER_BUCKETS; ++b) {
+            if (b < NUM_JITTER_BUCKETS - 1) {
+                std::cout << "<=" << JITTER_BUCKETS_US[b] << "us:";
+            } else {
+                std::cout << ">" << JITTER_BUCKETS_US[b - 1] << "us:";
+            }
+            std::cout << jitter_histogram[i][b] << " ";
+        }
+        std::cout << std::endl;
+
+        std::cout << "  录制：写入 " << recorded_frames[i].load()
+                  << " 帧，阻塞 " << record_blocked[i].load()
+                  << " 次，覆盖旧帧 " << record_dropped_oldest[i].load()
+                  << "，丢弃新帧 " << record_dropped_newest[i].load() << std::endl;
+        if (pretrigger_rings[i].capacity() > 0) {
+            std::cout << "  事件片段：写入 " << event_frames[i].load() << " 帧，环中没有空槽而没能写入 "
+                      << event_dropped[i].load() << " 帧" << std::endl;
+        }
+        if (record_scheduler.ready()) {
+            const SlotScheduler::CameraStats& sched = record_scheduler.stats(i);
+            std::cout << "  录制调度：权重 " << record_scheduler.weight(i) << "，份额 " << record_scheduler.share(i)
+                      << " 槽，最多占用 " << sched.peak.load() << " 槽，取槽 " << sched.admitted.load()
+                      << " 次（超出份额借用 " << sched.borrowed.load() << "），没有取到槽 " << sched.throttled.load()
+                      << " 次，等待 p99 " << record_wait_ns[i].percentile(99) / 1000 << " us" << std::endl;
+        }
+        const ReconnectStats& stats = reconnect_stats[i];
+        if (stats.losses > 0) {
+            std::cout << "  掉线 " << stats.losses << " 次，重连 " << stats.reconnects
+                      << " 次，总中断 " << stats.total_outage_us / 1000 << " ms，最长中断 " << stats.max_outage_us / 1000
+                      << " ms，最长重连延迟 " << stats.max_latency_us / 1000 << " ms" << std::endl;
+        }
+    }
+    if (record_scheduler.ready()) {
+        std::cout << "录制帧池按权重分配的公平指数（Jain，1为完全公平）：" << record_scheduler.fairness_index() << std::endl;
+    }
+    if (snapshot_job_id.load() > 0) {
+        std::cout << "快照请求：" << snapshot_job_id.load() << " 次，至少保存了一个相机的 " << snapshot_job_ns.count()
+                  << " 次，请求到落盘 p50 " << snapshot_job_ns.percentile(50) / 1000 << " us，p99 "
+                  << snapshot_job_ns.percentile(99) / 1000 << " us" << std::endl;
+    }
+    const LatencyHistogram& dispatch = control_server.dispatch_latency();
+    if (dispatch.count() > 0) {
+        std::cout << "控制命令分发延迟：p50 " << dispatch.percentile(50) / 1000 << " us，p99 " << dispatch.percentile(99) / 1000
+                  << " us" << std::endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,155 @@
+#include "metrics.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void PrometheusText::declare(const std::string& name, const char* type, const char* help) {
+    out_ << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+}
+
+void PrometheusText::value(const std::string& name, const std::string& labels, double value) {
+    out_ << name;
+    if (!labels.empty()) {
+        out_ << "{" << labels << "}";
+    }
+    out_ << " " << value << "\n";
+}
+
+void PrometheusText::histogram(const std::string& name, const std::string& labels, const LatencyHistogram& histogram) {
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    uint64_t cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        cumulative += histogram.bucket(i);
+        // 桶0上限为1微秒，之后每4个桶正好是一个2倍区间
+        if (i % 4 == 0 && i + 4 < LatencyHistogram::NUM_BUCKETS) {
+            out_ << name << "_bucket{" << prefix << "le=\"" << LatencyHistogram::bucket_upper_ns(i) / 1e9 << "\"} "
+                 << cumulative << "\n";
+        }
+    }
+    out_ << name << "_bucket{" << prefix << "le=\"+Inf\"} " << cumulative << "\n";
+    value(name + "_sum", labels, histogram.sum_ns() / 1e9);
+    value(name + "_count", labels, static_cast<double>(cumulative));
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+bool MetricsServer::start(const std::string& path, Render render) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "指标套接字路径太长：" << path << std::endl;
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (listen_fd_ == -1) {
+        std::cerr << "创建指标套接字失败：" << strerror(errno) << std::endl;
+        return false;
+    }
+    unlink(path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 || listen(listen_fd_, 8) == -1) {
+        std::cerr << "绑定指标套接字失败：" << path << " - " << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+    stop_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stop_fd_ == -1) {
+        std::cerr << "创建eventfd失败：" << strerror(errno) << std::endl;
+        close(listen_fd_);
+        listen_fd_ = -1;
+        unlink(path.c_str());
+        return false;
+    }
+
+    path_ = path;
+    render_ = std::move(render);
+    thread_ = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+    uint64_t one = 1;
+    if (write(stop_fd_, &one, sizeof(one)) == -1) {
+        std::cerr << "停止指标服务失败：" << strerror(errno) << std::endl;
+    }
+    thread_.join();
+    close(listen_fd_);
+    close(stop_fd_);
+    listen_fd_ = -1;
+    stop_fd_ = -1;
+    unlink(path_.c_str());
+}
+
+void MetricsServer::serve() {
+    struct pollfd fds[2];
+    fds[0] = {listen_fd_, POLLIN, 0};
+    fds[1] = {stop_fd_, POLLIN, 0};
+    while (true) {
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "指标服务poll错误：" << strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client != -1) {
+                // 客户端不读时最多阻塞1秒
+                struct timeval timeout = {1, 0};
+                setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                handle_client(client);
+                close(client);
+            }
+        }
+    }
+}
+
+void MetricsServer::handle_client(int client) {
+    // 最多等100毫秒读取请求行，纯文本客户端可以不发送任何内容
+    char request[512];
+    ssize_t received = 0;
+    struct pollfd pfd = {client, POLLIN, 0};
+    if (poll(&pfd, 1, 100) > 0) {
+        received = recv(client, request, sizeof(request), MSG_DONTWAIT);
+    }
+    bool http = received >= 3 && memcmp(request, "GET", 3) == 0;
+
+    std::string body = render_();
+    std::string response;
+    if (http) {
+        response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                   std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    }
+    response += body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
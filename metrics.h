@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "disk_writer.h"
+
+// 指标导出。采集路径上的计数器和直方图都是 relaxed 原子量，由调用者自己持有；
+// 这里只负责在被读取时生成 Prometheus 文本格式，以及通过本地 Unix 套接字提供出去。
+
+// Prometheus 文本格式（0.0.4）生成器
+class PrometheusText {
+public:
+    // 每个指标名先声明一次类型和说明
+    void declare(const std::string& name, const char* type, const char* help);
+
+    // labels 形如 camera="0"，可以为空
+    void value(const std::string& name, const std::string& labels, double value);
+
+    // 直方图以秒为单位导出，桶边界按2倍递增（LatencyHistogram 每4个桶合并为一个）
+    void histogram(const std::string& name, const std::string& labels, const LatencyHistogram& histogram);
+
+    std::string str() const { return out_.str(); }
+
+private:
+    std::ostringstream out_;
+};
+
+// 本地 Unix 套接字上的指标服务：每个连接返回一次 render() 生成的文本后关闭。
+// 请求以 "GET" 开头时加上 HTTP 响应头，可直接用
+//   curl --unix-socket <path> http://localhost/metrics
+// 抓取；其他客户端（如 socat）连上即可读到纯文本
+class MetricsServer {
+public:
+    using Render = std::function<std::string()>;
+
+    MetricsServer() = default;
+    ~MetricsServer();
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // 创建套接字（已存在的同名文件先删除）并启动服务线程，失败时返回false
+    bool start(const std::string& path, Render render);
+    void stop();
+
+private:
+    void serve();
+    void handle_client(int client);
+
+    std::string path_;
+    Render render_;
+    int listen_fd_ = -1;
+    int stop_fd_ = -1;
+    std::thread thread_;
+};
@@ -0,0 +1,117 @@
+#include "mjpeg_decode.h"
+
+#include <csetjmp>
+#include <cstdio>
+#include <utility>
+#include <jpeglib.h>
+
+namespace {
+
+// libjpeg 默认的错误处理会直接退出进程，这里改为 longjmp 回到 decode
+struct JpegErrorManager {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void on_jpeg_error(j_common_ptr cinfo) {
+    auto* error = reinterpret_cast<JpegErrorManager*>(cinfo->err);
+    (*cinfo->err->format_message)(cinfo, error->message);
+    longjmp(error->jump, 1);
+}
+
+// 损坏的 MJPEG 帧很常见，警告不打印
+void on_jpeg_message(j_common_ptr, int) {}
+
+}  // namespace
+
+struct MjpegDecoder::State {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager error;
+};
+
+MjpegDecoder::MjpegDecoder() : state_(new State) {
+    state_->cinfo.err = jpeg_std_error(&state_->error.pub);
+    state_->error.pub.error_exit = on_jpeg_error;
+    state_->error.pub.emit_message = on_jpeg_message;
+    jpeg_create_decompress(&state_->cinfo);
+}
+
+MjpegDecoder::~MjpegDecoder() {
+    jpeg_destroy_decompress(&state_->cinfo);
+    delete state_;
+}
+
+bool MjpegDecoder::decode(const uint8_t* jpeg, size_t size, uint8_t* dst, int dst_width, int dst_height, size_t dst_stride) {
+    struct jpeg_decompress_struct& cinfo = state_->cinfo;
+    if (setjmp(state_->error.jump)) {
+        error_ = state_->error.message;
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, jpeg, static_cast<unsigned long>(size));
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        error_ = "没有JPEG图像";
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    // 选取不小于目标尺寸的最小缩放比例 scale/8
+    int scale = 8;
+    while (scale > 1 && static_cast<int>(cinfo.image_width * (scale - 1) / 8) >= dst_width &&
+           static_cast<int>(cinfo.image_height * (scale - 1) / 8) >= dst_height) {
+        --scale;
+    }
+    cinfo.scale_num = scale;
+    cinfo.scale_denom = 8;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+#ifdef JCS_EXTENSIONS
+    cinfo.out_color_space = JCS_EXT_BGR;
+#else
+    cinfo.out_color_space = JCS_RGB;
+#endif
+    jpeg_start_decompress(&cinfo);
+
+    const int out_width = static_cast<int>(cinfo.output_width);
+    const int out_height = static_cast<int>(cinfo.output_height);
+    const bool direct = out_width == dst_width && out_height == dst_height;
+    row_.resize(static_cast<size_t>(out_width) * cinfo.output_components);
+
+    // 与 yuyv_to_bgr_downscale 相同的最近邻映射：目标第 y 行取自解码的第 (2y+1)*H/(2h) 行
+    int dst_y = 0;
+    while (cinfo.output_scanline < cinfo.output_height && dst_y < dst_height) {
+        int src_y = static_cast<int>(cinfo.output_scanline);
+        uint8_t* line = direct ? dst + static_cast<size_t>(dst_y) * dst_stride : row_.data();
+        JSAMPROW rows[1] = {line};
+        jpeg_read_scanlines(&cinfo, rows, 1);
+        if (direct) {
+#ifndef JCS_EXTENSIONS
+            for (int x = 0; x < out_width; ++x) {
+                std::swap(line[x * 3], line[x * 3 + 2]);
+            }
+#endif
+            ++dst_y;
+            continue;
+        }
+        while (dst_y < dst_height && static_cast<int>((2LL * dst_y + 1) * out_height / (2LL * dst_height)) == src_y) {
+            uint8_t* out = dst + static_cast<size_t>(dst_y) * dst_stride;
+            for (int x = 0; x < dst_width; ++x) {
+                const uint8_t* p = line + static_cast<int>((2LL * x + 1) * out_width / (2LL * dst_width)) * 3;
+#ifdef JCS_EXTENSIONS
+                out[x * 3] = p[0];
+                out[x * 3 + 2] = p[2];
+#else
+                out[x * 3] = p[2];
+                out[x * 3 + 2] = p[0];
+#endif
+                out[x * 3 + 1] = p[1];
+            }
+            ++dst_y;
+        }
+    }
+    // 不需要的剩余行直接放弃，不必解码完
+    jpeg_abort_decompress(&cinfo);
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// MJPEG 帧解码为缩小的 BGR 图像，只用于预览。基于 libjpeg-turbo 的 jpeglib 接口：
+// 解码时按 1/8 到 1 的比例在 DCT 阶段直接缩小，选取不小于目标尺寸的最小比例，
+// 再按最近邻采样到目标大小，所以缩小越多解码越快。
+// UVC 相机输出的帧通常省略 Huffman 表，libjpeg-turbo 会自动使用标准表。
+// 解码器对象保存 libjpeg 状态和行缓冲区，只能在一个线程中使用
+class MjpegDecoder {
+public:
+    MjpegDecoder();
+    ~MjpegDecoder();
+    MjpegDecoder(const MjpegDecoder&) = delete;
+    MjpegDecoder& operator=(const MjpegDecoder&) = delete;
+
+    // 解码 jpeg（size 字节）到 dst（dst_width x dst_height，3通道，行跨度 dst_stride 字节）。
+    // 帧损坏时返回false，error() 给出原因，dst 可能只写了一部分
+    bool decode(const uint8_t* jpeg, size_t size, uint8_t* dst, int dst_width, int dst_height, size_t dst_stride);
+
+    const std::string& error() const { return error_; }
+
+private:
+    struct State;
+    State* state_;
+    std::vector<uint8_t> row_;
+    std::string error_;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "frame_pool.h"
+
+// 预触发环：一个相机最近若干帧的副本，用于事件触发时写出触发前的画面。
+//
+// 槽一次性分配并预先触碰（借用 FramePool 的内存布局，不使用它的空闲栈），
+// 每个槽的布局与录制帧池相同：[容器帧头块][帧数据]，写盘时整块一次写出。
+// 采集反应器按顺序覆盖最旧的槽；事件触发后窗口内的槽被钉住交给写线程，
+// 写完之前不会被覆盖，所有槽都被钉住时新帧不进入环。
+//
+// next_slot、commit 和 pin_since 只在所属的采集反应器中调用，unpin 可以在写线程中调用。
+class PretriggerRing {
+public:
+    // 槽中帧的元数据，钉住后写线程只读
+    struct Slot {
+        size_t size = 0;
+        uint32_t sequence = 0;
+        int64_t timestamp_us = 0;  // 驱动时间戳
+        int64_t arrival_us = 0;    // 取出时的 CLOCK_MONOTONIC，回放源的驱动时间戳不是当前时间，窗口按它划定
+        bool valid = false;
+        std::atomic<bool> pinned{false};
+    };
+
+    // 分配 slot_count 个槽，每个槽可容纳 payload_size 字节的帧数据，前面预留 header_block 字节。
+    // 只能在没有槽被钉住时调用，失败时返回false
+    bool init(size_t slot_count, size_t payload_size, size_t header_block, size_t alignment) {
+        capacity_ = 0;
+        payload_capacity_ = align_up_to(payload_size, alignment);
+        header_block_ = header_block;
+        if (!memory_.init(slot_count, header_block_ + payload_capacity_, alignment)) {
+            return false;
+        }
+        slots_ = std::make_unique<Slot[]>(slot_count);
+        next_ = 0;
+        capacity_ = slot_count;
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+    size_t payload_capacity() const { return payload_capacity_; }
+    // 每个槽占用的内存
+    size_t slot_bytes() const { return header_block_ + payload_capacity_; }
+
+    uint8_t* entry(int slot) const { return memory_.data(slot); }
+    uint8_t* payload(int slot) const { return memory_.data(slot) + header_block_; }
+    const Slot& slot(int slot) const { return slots_[slot]; }
+
+    // 取出最旧的未钉住的槽准备覆盖，所有槽都被钉住时返回-1
+    int next_slot() {
+        for (size_t i = 0; i < capacity_; ++i) {
+            size_t index = (next_ + i) % capacity_;
+            if (!slots_[index].pinned.load(std::memory_order_acquire)) {
+                next_ = (index + 1) % capacity_;
+                slots_[index].valid = false;
+                return static_cast<int>(index);
+            }
+        }
+        return -1;
+    }
+
+    void commit(int slot, size_t size, uint32_t sequence, int64_t timestamp_us, int64_t arrival_us) {
+        Slot& s = slots_[slot];
+        s.size = size;
+        s.sequence = sequence;
+        s.timestamp_us = timestamp_us;
+        s.arrival_us = arrival_us;
+        s.valid = true;
+    }
+
+    // 钉住一个刚写入的槽
+    void pin(int slot) { slots_[slot].pinned.store(true, std::memory_order_relaxed); }
+
+    // 从最旧到最新钉住到达时间不早于 since_us 的槽，对每个槽调用 on_pinned(slot)
+    template <typename Fn>
+    void pin_since(int64_t since_us, Fn on_pinned) {
+        for (size_t i = 0; i < capacity_; ++i) {
+            int index = static_cast<int>((next_ + i) % capacity_);
+            Slot& s = slots_[index];
+            if (s.valid && s.arrival_us >= since_us && !s.pinned.load(std::memory_order_relaxed)) {
+                s.pinned.store(true, std::memory_order_relaxed);
+                on_pinned(index);
+            }
+        }
+    }
+
+    // 写盘完成后调用，槽可以再次覆盖
+    void unpin(int slot) { slots_[slot].pinned.store(false, std::memory_order_release); }
+
+private:
+    static size_t align_up_to(size_t value, size_t alignment) { return (value + alignment - 1) / alignment * alignment; }
+
+    FramePool memory_;
+    std::unique_ptr<Slot[]> slots_;
+    size_t capacity_ = 0;
+    size_t payload_capacity_ = 0;
+    size_t header_block_ = 0;
+    size_t next_ = 0;
+};
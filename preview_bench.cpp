@@ -0,0 +1,113 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+#include "yuyv_convert.h"
+
+// 预览转换的校验和基准：
+//   1. SIMD 实现必须与标量实现逐字节一致（随机噪声输入）；
+//   2. 与 OpenCV 的 cvtColor + resize 对比（平滑渐变输入），行最近邻采样与 OpenCV 的插值
+//      只在边缘处有差异，平均误差应很小；
+//   3. 对比两者每帧耗时。
+// 校验失败时返回非零
+
+constexpr int SRC_WIDTH = 1280;
+constexpr int SRC_HEIGHT = 720;
+constexpr int DST_WIDTH = 640;
+constexpr int DST_HEIGHT = 480;
+constexpr int ITERATIONS = 200;
+constexpr double MAX_MEAN_ERROR = 2.0;  // 与 OpenCV 对比的平均误差上限（每通道）
+
+// 生成 YUYV 测试帧：noise 为 true 时每字节随机，否则为平滑渐变
+std::vector<uint8_t> make_frame(bool noise) {
+    std::vector<uint8_t> frame(SRC_WIDTH * 2 * SRC_HEIGHT);
+    uint32_t seed = 12345;
+    for (int y = 0; y < SRC_HEIGHT; ++y) {
+        for (int x = 0; x < SRC_WIDTH; x += 2) {
+            uint8_t* p = &frame[y * SRC_WIDTH * 2 + x * 2];
+            if (noise) {
+                for (int i = 0; i < 4; ++i) {
+                    seed = seed * 1103515245 + 12345;
+                    p[i] = static_cast<uint8_t>(seed >> 16);
+                }
+            } else {
+                p[0] = static_cast<uint8_t>(16 + x * 219 / SRC_WIDTH);
+                p[2] = static_cast<uint8_t>(16 + (x + 1) * 219 / SRC_WIDTH);
+                p[1] = static_cast<uint8_t>(16 + y * 224 / SRC_HEIGHT);
+                p[3] = static_cast<uint8_t>(240 - y * 224 / SRC_HEIGHT);
+            }
+        }
+    }
+    return frame;
+}
+
+template <typename F>
+double time_per_frame_us(F&& convert) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        convert();
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / ITERATIONS;
+}
+
+int main() {
+    bool ok = true;
+    const size_t src_stride = SRC_WIDTH * 2;
+    const size_t dst_stride = DST_WIDTH * 3;
+    std::vector<uint8_t> fast(dst_stride * DST_HEIGHT);
+    std::vector<uint8_t> scalar(dst_stride * DST_HEIGHT);
+
+    // SIMD 与标量逐字节对比
+    std::vector<uint8_t> noise = make_frame(true);
+    yuyv_to_bgr_downscale(noise.data(), SRC_WIDTH, SRC_HEIGHT, src_stride, fast.data(), DST_WIDTH, DST_HEIGHT, dst_stride);
+    yuyv_to_bgr_downscale_scalar(noise.data(), SRC_WIDTH, SRC_HEIGHT, src_stride, scalar.data(), DST_WIDTH, DST_HEIGHT, dst_stride);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < fast.size(); ++i) {
+        mismatches += fast[i] != scalar[i];
+    }
+    std::cout << "实现：" << yuyv_kernel_name() << "，与标量实现不一致的字节数：" << mismatches << std::endl;
+    ok = ok && mismatches == 0;
+
+    // 与 OpenCV 对比
+    std::vector<uint8_t> gradient = make_frame(false);
+    cv::Mat yuyv(SRC_HEIGHT, SRC_WIDTH, CV_8UC2, gradient.data(), src_stride);
+    cv::Mat bgr, reference;
+    cv::cvtColor(yuyv, bgr, cv::COLOR_YUV2BGR_YUYV);
+    cv::resize(bgr, reference, cv::Size(DST_WIDTH, DST_HEIGHT));
+    yuyv_to_bgr_downscale(gradient.data(), SRC_WIDTH, SRC_HEIGHT, src_stride, fast.data(), DST_WIDTH, DST_HEIGHT, dst_stride);
+    double total_error = 0;
+    int max_error = 0;
+    for (int y = 0; y < DST_HEIGHT; ++y) {
+        const uint8_t* ref_row = reference.ptr<uint8_t>(y);
+        const uint8_t* row = fast.data() + y * dst_stride;
+        for (int i = 0; i < DST_WIDTH * 3; ++i) {
+            int error = std::abs(static_cast<int>(ref_row[i]) - static_cast<int>(row[i]));
+            total_error += error;
+            max_error = std::max(max_error, error);
+        }
+    }
+    double mean_error = total_error / (static_cast<double>(DST_WIDTH) * DST_HEIGHT * 3);
+    std::cout << "与 OpenCV 对比：平均误差 " << mean_error << "，最大误差 " << max_error << std::endl;
+    ok = ok && mean_error <= MAX_MEAN_ERROR;
+
+    // 耗时
+    double opencv_us = time_per_frame_us([&] {
+        cv::cvtColor(yuyv, bgr, cv::COLOR_YUV2BGR_YUYV);
+        cv::resize(bgr, reference, cv::Size(DST_WIDTH, DST_HEIGHT));
+    });
+    double scalar_us = time_per_frame_us([&] {
+        yuyv_to_bgr_downscale_scalar(gradient.data(), SRC_WIDTH, SRC_HEIGHT, src_stride, scalar.data(), DST_WIDTH, DST_HEIGHT, dst_stride);
+    });
+    double fast_us = time_per_frame_us([&] {
+        yuyv_to_bgr_downscale(gradient.data(), SRC_WIDTH, SRC_HEIGHT, src_stride, fast.data(), DST_WIDTH, DST_HEIGHT, dst_stride);
+    });
+    std::cout << "每帧耗时（微秒）：OpenCV cvtColor+resize " << opencv_us << "，标量 " << scalar_us
+              << "，" << yuyv_kernel_name() << " " << fast_us << std::endl;
+
+    std::cout << (ok ? "校验通过" : "校验失败") << std::endl;
+    return ok ? 0 : 1;
+}
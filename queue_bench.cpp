@@ -0,0 +1,128 @@
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+
+#include "lockfree_queue.h"
+
+// 对比保存队列的两种实现：原来的 std::queue + mutex + condition_variable，
+// 以及 LockFreeQueue + QueueWaker。多个生产者（模拟采集线程）对一个消费者（模拟保存线程）
+
+constexpr size_t QUEUE_CAPACITY = 64;
+
+// 原实现：有界 std::queue，满时生产者等待 not_full，消费者等待 not_empty
+class MutexQueue {
+public:
+    void push(uint64_t value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return queue_.size() < QUEUE_CAPACITY; });
+        queue_.push(value);
+        lock.unlock();
+        not_empty_.notify_one();
+    }
+
+    uint64_t pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !queue_.empty(); });
+        uint64_t value = queue_.front();
+        queue_.pop();
+        lock.unlock();
+        not_full_.notify_one();
+        return value;
+    }
+
+private:
+    std::queue<uint64_t> queue_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+// 无锁实现：满时生产者让出CPU重试，消费者空闲时在eventfd上休眠
+class LockFreeBenchQueue {
+public:
+    LockFreeBenchQueue() : queue_(QUEUE_CAPACITY) {}
+
+    void push(uint64_t value) {
+        while (!queue_.try_push(std::move(value))) {
+            std::this_thread::yield();
+        }
+        waker_.notify();
+    }
+
+    uint64_t pop() {
+        uint64_t value;
+        while (!queue_.try_pop(value)) {
+            waker_.wait([this] { return !queue_.empty_approx(); });
+        }
+        return value;
+    }
+
+private:
+    LockFreeQueue<uint64_t> queue_;
+    QueueWaker waker_;
+};
+
+// 运行一次测试，返回每秒传递的元素数
+template <typename Queue>
+double run(int producers, int items_per_producer) {
+    Queue queue;
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (int i = 0; i < items_per_producer; ++i) {
+                queue.push(static_cast<uint64_t>(p) << 32 | i);
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start = true;
+    uint64_t checksum = 0;
+    uint64_t total = static_cast<uint64_t>(producers) * items_per_producer;
+    for (uint64_t i = 0; i < total; ++i) {
+        checksum += queue.pop();
+    }
+    auto end = std::chrono::steady_clock::now();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // 校验没有丢失或重复的元素
+    uint64_t expected = 0;
+    for (int p = 0; p < producers; ++p) {
+        expected += (static_cast<uint64_t>(p) << 32) * items_per_producer +
+                    static_cast<uint64_t>(items_per_producer) * (items_per_producer - 1) / 2;
+    }
+    if (checksum != expected) {
+        std::cerr << "校验失败：元素丢失或重复" << std::endl;
+        std::exit(1);
+    }
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return total / seconds;
+}
+
+int main(int argc, char* argv[]) {
+    int items_per_producer = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    for (int producers : {6, 16}) {
+        double mutex_rate = run<MutexQueue>(producers, items_per_producer);
+        double lockfree_rate = run<LockFreeBenchQueue>(producers, items_per_producer);
+        std::cout << producers << " 个生产者："
+                  << "mutex队列 " << mutex_rate / 1e6 << " M/s，"
+                  << "无锁队列 " << lockfree_rate / 1e6 << " M/s，"
+                  << "加速比 " << lockfree_rate / mutex_rate << std::endl;
+    }
+    return 0;
+}
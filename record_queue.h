@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "lockfree_queue.h"
+
+// 录制队列：帧池的槽按采集顺序交给录制线程，DropOldest 策略可以撤回其中最旧的、
+// 属于指定相机的帧，把槽让给新帧。
+//
+// 每个槽有一个状态字：0表示不在队列中，否则为 (入队票号 << CAMERA_BITS) | 相机编号。
+// 队列中的项带票号，撤回只把状态字清零，留在无锁队列中的过期项出队时跳过，
+// 所以撤回不需要从队列中间删除。过期项达到槽数时不允许撤回，过期项因此不会
+// 超过槽数加上并发撤回的线程数，队列容量按此预留，入队不会失败。
+//
+// 过期项计数在撤回者清零状态字之前加一（清零失败时撤销），出队者只有看到清零后才减一，
+// 所以计数不会小于零；出队时与撤回者竞争失败的项同样算作过期项出队。
+class RecordQueue {
+public:
+    static constexpr int CAMERA_BITS = 8;
+
+    // 只能在没有其他线程使用队列时调用
+    void init(size_t slots) {
+        slots_ = slots;
+        states_ = std::make_unique<std::atomic<uint64_t>[]>(slots);
+        queue_.init(2 * slots + (size_t(1) << CAMERA_BITS));
+    }
+
+    // 槽中的帧已填好，交给录制线程
+    void push(int slot, int camera_id) {
+        uint64_t ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed) + 1;
+        states_[slot].store(ticket << CAMERA_BITS | static_cast<uint64_t>(camera_id), std::memory_order_release);
+        queue_.try_push(Entry{slot, ticket});
+    }
+
+    // 取出最早入队的、没有被撤回的槽，队列为空时返回false
+    bool pop(int& slot) {
+        Entry entry;
+        while (queue_.try_pop(entry)) {
+            uint64_t state = states_[entry.slot].load(std::memory_order_acquire);
+            if (state >> CAMERA_BITS != entry.ticket) {
+                stale_.fetch_sub(1, std::memory_order_relaxed);
+                continue;  // 已被撤回，槽可能已经以新票号重新入队
+            }
+            if (states_[entry.slot].compare_exchange_strong(state, 0, std::memory_order_acq_rel)) {
+                slot = entry.slot;
+                return true;
+            }
+            stale_.fetch_sub(1, std::memory_order_relaxed);  // 刚被撤回
+        }
+        return false;
+    }
+
+    // 撤回 eligible(相机编号) 为true的相机中最早入队的帧，返回它的槽，没有可撤回的帧时返回-1。
+    // 撤回后槽归调用者所有
+    template <typename Pred>
+    int withdraw_oldest(Pred eligible) {
+        if (stale_.load(std::memory_order_relaxed) >= static_cast<int64_t>(slots_)) {
+            return -1;
+        }
+        while (true) {
+            int oldest = -1;
+            uint64_t oldest_state = 0;
+            for (size_t i = 0; i < slots_; ++i) {
+                uint64_t state = states_[i].load(std::memory_order_acquire);
+                if (state != 0 && (oldest < 0 || state < oldest_state) &&
+                    eligible(static_cast<int>(state & ((uint64_t(1) << CAMERA_BITS) - 1)))) {
+                    oldest = static_cast<int>(i);
+                    oldest_state = state;
+                }
+            }
+            if (oldest < 0) {
+                return -1;
+            }
+            // 与录制线程或其他撤回者竞争失败时重新查找
+            stale_.fetch_add(1, std::memory_order_relaxed);
+            if (states_[oldest].compare_exchange_strong(oldest_state, 0, std::memory_order_acq_rel)) {
+                return oldest;
+            }
+            stale_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 包括尚未跳过的过期项，只用于统计和唤醒判断
+    size_t size_approx() const { return queue_.size_approx(); }
+    bool empty_approx() const { return queue_.empty_approx(); }
+
+private:
+    struct Entry {
+        int slot = -1;
+        uint64_t ticket = 0;
+    };
+
+    LockFreeQueue<Entry> queue_;
+    std::unique_ptr<std::atomic<uint64_t>[]> states_;
+    size_t slots_ = 0;
+    std::atomic<uint64_t> next_ticket_{0};
+    std::atomic<int64_t> stale_{0};  // 队列中已撤回的项
+};
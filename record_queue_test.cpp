@@ -0,0 +1,190 @@
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "frame_pool.h"
+#include "record_queue.h"
+#include "slot_scheduler.h"
+
+// 录制帧池 DropOldest 策略的校验：按 main.cpp 的取槽顺序（调度器准入，失败时撤回
+// 本相机或超出份额的相机最旧的排队帧，再失败丢弃新帧）模拟一个相机持续灌满帧池、
+// 另一个相机低速录制，录制线程每三个周期才写出一帧。
+//   1. 低速相机的用量始终在份额内，它的帧不能被覆盖或丢弃；
+//   2. 录制线程按入队顺序取到帧，同一相机的帧序号递增；
+//   3. 只有份额内的其他相机的帧在排队时，撤回失败。
+// 之后多个线程并发撤回、录制线程同时出队，队列排空后过期项计数必须回到零，
+// 否则撤回会一直被拒绝。校验失败时返回非零
+
+constexpr int POOL_FRAMES = 8;
+constexpr int TICKS = 10000;
+constexpr int FLOOD_FRAMES_PER_TICK = 4;  // 相机0每个周期送来的帧数
+constexpr int SLOW_INTERVAL = 4;          // 相机1每隔几个周期送来一帧
+constexpr int WRITE_INTERVAL = 3;         // 录制线程每隔几个周期写出一帧
+constexpr int RACE_THREADS = 3;           // 并发取槽（必要时撤回）的线程数
+constexpr int RACE_FRAMES = 100000;       // 每个线程送来的帧数
+
+struct Slot {
+    int camera_id = -1;
+    int sequence = 0;
+};
+
+int main() {
+    FramePool pool;
+    if (!pool.init(POOL_FRAMES, 64, 64)) {
+        std::cerr << "分配帧池失败" << std::endl;
+        return 1;
+    }
+    std::vector<Slot> slots(POOL_FRAMES);
+    RecordQueue queue;
+    queue.init(POOL_FRAMES);
+    SlotScheduler scheduler(2);
+    scheduler.init(POOL_FRAMES, {1, 1});
+    scheduler.set_active(0, true);
+    scheduler.set_active(1, true);
+
+    std::vector<int> sequence(2, 0);
+    std::vector<int> lost(2, 0);     // 被覆盖或丢弃的帧
+    std::vector<int> written(2, 0);
+    std::vector<int> last_written(2, -1);
+    bool ok = true;
+
+    auto record = [&](int camera_id) {
+        int seq = sequence[camera_id]++;
+        int slot = -1;
+        if (scheduler.admit(camera_id, static_cast<int>(pool.available()))) {
+            slot = pool.acquire();
+            if (slot >= 0) {
+                scheduler.acquired(camera_id);
+            }
+        }
+        if (slot < 0) {
+            scheduler.throttled(camera_id);
+            slot = queue.withdraw_oldest(
+                [&](int victim) { return victim == camera_id || scheduler.over_share(victim); });
+            if (slot < 0) {
+                ++lost[camera_id];
+                return;
+            }
+            ++lost[slots[slot].camera_id];
+            scheduler.released(slots[slot].camera_id);
+            scheduler.acquired(camera_id);
+        }
+        slots[slot] = Slot{camera_id, seq};
+        queue.push(slot, camera_id);
+    };
+
+    for (int tick = 0; tick < TICKS; ++tick) {
+        if (tick % SLOW_INTERVAL == 0) {
+            record(1);
+        }
+        for (int i = 0; i < FLOOD_FRAMES_PER_TICK; ++i) {
+            record(0);
+        }
+        int slot;
+        if (tick % WRITE_INTERVAL == 0 && queue.pop(slot)) {
+            const Slot& s = slots[slot];
+            if (s.sequence <= last_written[s.camera_id]) {
+                std::cerr << "相机 " << s.camera_id << " 的帧乱序：" << s.sequence << " 在 " << last_written[s.camera_id]
+                          << " 之后写出" << std::endl;
+                ok = false;
+            }
+            last_written[s.camera_id] = s.sequence;
+            ++written[s.camera_id];
+            scheduler.released(s.camera_id);
+            pool.release(slot);
+        }
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        std::cout << "相机 " << i << "：送来 " << sequence[i] << " 帧，写出 " << written[i] << " 帧，覆盖或丢弃 " << lost[i]
+                  << " 帧" << std::endl;
+    }
+    if (lost[1] != 0) {
+        std::cerr << "份额内的相机1丢失了 " << lost[1] << " 帧" << std::endl;
+        ok = false;
+    }
+    if (lost[0] == 0) {
+        std::cerr << "相机0没有灌满帧池，模拟没有覆盖到 DropOldest" << std::endl;
+        ok = false;
+    }
+
+    // 队列中只剩份额内的相机1的帧时，相机0不能撤回
+    int slot;
+    while (queue.pop(slot)) {
+        scheduler.released(slots[slot].camera_id);
+        pool.release(slot);
+    }
+    slot = pool.acquire();
+    scheduler.acquired(1);
+    slots[slot] = Slot{1, sequence[1]++};
+    queue.push(slot, 1);
+    if (queue.withdraw_oldest([&](int victim) { return victim == 0 || scheduler.over_share(victim); }) >= 0) {
+        std::cerr << "撤回了份额内的相机1的帧" << std::endl;
+        ok = false;
+    }
+
+    // 并发撤回和出队：取不到空闲槽时撤回任意相机最旧的帧
+    RecordQueue race_queue;
+    race_queue.init(POOL_FRAMES);
+    FramePool race_pool;
+    race_pool.init(POOL_FRAMES, 64, 64);
+    std::atomic<int> producers(RACE_THREADS);
+    std::atomic<long> withdrawn(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < RACE_THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < RACE_FRAMES; ++i) {
+                int s = race_pool.acquire();
+                while (s < 0) {
+                    s = race_queue.withdraw_oldest([](int) { return true; });
+                    if (s >= 0) {
+                        withdrawn.fetch_add(1, std::memory_order_relaxed);
+                    } else if ((s = race_pool.acquire()) < 0) {
+                        std::this_thread::yield();  // 过期项太多，等录制线程跳过
+                    }
+                }
+                race_queue.push(s, t);
+            }
+            producers.fetch_sub(1);
+        });
+    }
+    // 录制线程比取槽慢，帧池大部分时间是满的，撤回和出队经常争抢同一个槽
+    threads.emplace_back([&] {
+        int s;
+        while (producers.load() > 0) {
+            if (race_queue.pop(s)) {
+                race_pool.release(s);
+            }
+            std::this_thread::yield();
+        }
+    });
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    while (race_queue.pop(slot)) {
+        race_pool.release(slot);
+    }
+    std::cout << "并发撤回 " << withdrawn.load() << " 帧" << std::endl;
+
+    // 排空后没有过期项，所有槽入队后应当都能撤回
+    int refilled = 0;
+    while ((slot = race_pool.acquire()) >= 0) {
+        race_queue.push(slot, 0);
+        ++refilled;
+    }
+    for (int i = 0; i < refilled; ++i) {
+        if (race_queue.withdraw_oldest([](int) { return true; }) < 0) {
+            std::cerr << "并发撤回后过期项计数没有归零，第 " << i + 1 << " 次撤回被拒绝" << std::endl;
+            ok = false;
+            break;
+        }
+    }
+    if (refilled != POOL_FRAMES || withdrawn.load() == 0) {
+        std::cerr << "并发模拟没有覆盖到撤回：空闲槽 " << refilled << "，撤回 " << withdrawn.load() << std::endl;
+        ok = false;
+    }
+
+    std::cout << (ok ? "校验通过" : "校验失败") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 共享帧池的准入控制：按权重给每个相机保底份额的加权公平分配。
+//
+// 每个相机按权重保底获得 容量 × 权重 / 总权重 个槽（至少1个）。帧池有空闲时，
+// 相机可以借用超出份额的槽，只要借出后剩余的空闲槽仍够其他活动相机用满各自
+// 尚未用完的份额；否则拒绝，由调用者按录制策略阻塞或丢帧。所以用量没有超过份额的
+// 相机总能拿到槽，磁盘跟得上时帧池不会饱和，也就不会限制任何相机。
+//
+// 帧在帧池中排队的时间对所有相机相同，占用的槽数与帧率成正比，
+// 因此默认权重取相机的帧率。
+//
+// 计数都是relaxed原子操作，admit 与其他线程的 acquired/released 并发时结果是近似的，
+// 槽的实际数量仍由帧池保证。weight、share、stats 和 fairness_index 只能在 ready() 之后读取。
+class SlotScheduler {
+public:
+    // 每个相机的调度统计
+    struct CameraStats {
+        std::atomic<uint64_t> admitted{0};   // 取到槽的次数
+        std::atomic<uint64_t> borrowed{0};   // 其中超出份额借用的次数
+        std::atomic<uint64_t> throttled{0};  // 没能取到槽的次数
+        std::atomic<int> peak{0};            // 同时占用的最多槽数
+    };
+
+    // 按相机编号的上限分配计数，之后可以随时调用 set_active
+    explicit SlotScheduler(int max_cameras)
+        : used_(std::make_unique<std::atomic<int>[]>(max_cameras)),
+          active_(std::make_unique<std::atomic<bool>[]>(max_cameras)),
+          stats_(std::make_unique<CameraStats[]>(max_cameras)) {}
+
+    // 按权重计算前 weights.size() 个相机的份额，只调用一次。
+    // admit、acquired、released 只能在 ready() 之后调用
+    void init(int capacity, const std::vector<int>& weights) {
+        weights_ = weights;
+        shares_.assign(weights_.size(), 0);
+        long long total = 0;
+        for (int w : weights_) {
+            total += std::max(0, w);
+        }
+        for (size_t i = 0; i < weights_.size(); ++i) {
+            long long share = total > 0 ? capacity * static_cast<long long>(std::max(0, weights_[i])) / total : 0;
+            shares_[i] = std::max(1, static_cast<int>(share));
+        }
+        count_ = static_cast<int>(weights_.size());
+        ready_.store(true, std::memory_order_release);
+    }
+
+    bool ready() const { return ready_.load(std::memory_order_acquire); }
+
+    // 掉线或回放结束的相机不再为它保留份额
+    void set_active(int camera, bool active) { active_[camera].store(active, std::memory_order_relaxed); }
+
+    // free 为帧池当前的空闲槽数，返回是否允许该相机再取一个槽
+    bool admit(int camera, int free) const {
+        if (used_[camera].load(std::memory_order_relaxed) >= shares_[camera] &&
+            free <= reserved_by_others(camera)) {
+            return false;
+        }
+        return free > 0;
+    }
+
+    // 相机没能取到槽（被拒绝或帧池已空）时调用一次
+    void throttled(int camera) { stats_[camera].throttled.fetch_add(1, std::memory_order_relaxed); }
+
+    // 取到槽后调用
+    void acquired(int camera) {
+        int used = used_[camera].fetch_add(1, std::memory_order_relaxed) + 1;
+        CameraStats& stats = stats_[camera];
+        stats.admitted.fetch_add(1, std::memory_order_relaxed);
+        if (used > shares_[camera]) {
+            stats.borrowed.fetch_add(1, std::memory_order_relaxed);
+        }
+        int peak = stats.peak.load(std::memory_order_relaxed);
+        while (peak < used && !stats.peak.compare_exchange_weak(peak, used, std::memory_order_relaxed)) {
+        }
+    }
+
+    // 归还槽后调用
+    void released(int camera) { used_[camera].fetch_sub(1, std::memory_order_relaxed); }
+
+    int weight(int camera) const { return weights_[camera]; }
+    int share(int camera) const { return shares_[camera]; }
+    int used(int camera) const { return used_[camera].load(std::memory_order_relaxed); }
+    // 用量超过份额，DropOldest 策略只覆盖这样的相机（或请求者自己）的帧
+    bool over_share(int camera) const { return used(camera) > shares_[camera]; }
+    const CameraStats& stats(int camera) const { return stats_[camera]; }
+
+    // 各相机按权重归一化的取槽次数的 Jain 公平指数：1表示完全按权重分配，
+    // 越接近 1/n 说明越集中在少数相机上。没有数据时为1
+    double fairness_index() const {
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        int n = 0;
+        for (int i = 0; i < count_; ++i) {
+            if (weights_[i] <= 0) {
+                continue;
+            }
+            double x = static_cast<double>(stats_[i].admitted.load(std::memory_order_relaxed)) / weights_[i];
+            sum += x;
+            sum_sq += x * x;
+            ++n;
+        }
+        return sum_sq > 0.0 ? sum * sum / (n * sum_sq) : 1.0;
+    }
+
+private:
+    // 其他活动相机尚未用完的份额之和
+    int reserved_by_others(int camera) const {
+        int reserved = 0;
+        for (int i = 0; i < count_; ++i) {
+            if (i != camera && active_[i].load(std::memory_order_relaxed)) {
+                reserved += std::max(0, shares_[i] - used_[i].load(std::memory_order_relaxed));
+            }
+        }
+        return reserved;
+    }
+
+    std::unique_ptr<std::atomic<int>[]> used_;
+    std::unique_ptr<std::atomic<bool>[]> active_;
+    std::unique_ptr<CameraStats[]> stats_;
+    int count_ = 0;
+    std::vector<int> weights_;
+    std::vector<int> shares_;
+    std::atomic<bool> ready_{false};
+};
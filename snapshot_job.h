@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 一次快照请求：参与的每个相机保存一帧，用计数闩锁跟踪，最后一个相机的帧写盘并同步到磁盘
+// （或确定无法保存）时调用完成回调，不需要轮询。
+//
+// 每个相机的请求按顺序排在该相机的队列中，一帧只满足一个请求，所以连续多次请求
+// 各自得到不同的帧。target_us 为0时按顺序取请求之后相机处理的下一帧；否则取驱动时间戳
+// 最接近 target_us 的一帧（同步快照），已经过去的时刻从帧历史中选，将来的时刻等到
+// 帧越过它再选，等待期间不影响之后的普通请求。
+//
+// 一个相机的结果先由采集反应器填写帧信息，再由写线程填写写盘结果，两者经保存队列先后交接；
+// finish 对计数做 acq_rel 递减，完成回调看到的是所有相机的最终结果。
+class SnapshotJob {
+public:
+    struct CameraResult {
+        bool expected = false;        // 请求时相机正在采集
+        bool saved = false;           // 帧已写入快照容器并同步到磁盘
+        uint32_t sequence = 0;
+        int64_t timestamp_us = -1;    // 驱动时间戳，-1表示没有取到帧
+        int64_t handed_off_us = 0;    // 交给保存线程的时刻
+        int64_t completed_us = 0;     // 同步到磁盘（或放弃）的时刻
+        std::string path;
+    };
+    using Callback = std::function<void(const SnapshotJob&)>;
+
+    // cameras 为参与的相机编号，不能为空。完成回调在最后一个完成的相机所在线程中调用
+    SnapshotJob(uint64_t id, int64_t requested_us, int64_t target_us, int max_cameras, const std::vector<int>& cameras,
+                Callback on_complete)
+        : id_(id), requested_us_(requested_us), target_us_(target_us), results_(max_cameras),
+          remaining_(static_cast<int>(cameras.size())), on_complete_(std::move(on_complete)) {
+        for (int camera : cameras) {
+            results_[camera].expected = true;
+        }
+    }
+
+    uint64_t id() const { return id_; }
+    int64_t requested_us() const { return requested_us_; }
+    int64_t target_us() const { return target_us_; }
+    int camera_count() const { return static_cast<int>(results_.size()); }
+
+    // 完成前只有负责该相机的线程可以修改它的结果
+    CameraResult& result(int camera) { return results_[camera]; }
+    const CameraResult& result(int camera) const { return results_[camera]; }
+
+    // 相机的帧已同步到磁盘（saved 为true）或放弃，每个参与的相机调用一次
+    void finish(int camera, bool saved, int64_t now_us) {
+        results_[camera].saved = saved;
+        results_[camera].completed_us = now_us;
+        if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            completed_us_ = now_us;
+            if (on_complete_) {
+                on_complete_(*this);
+            }
+        }
+    }
+
+    // 最后一个相机完成的时刻，完成回调中有效
+    int64_t completed_us() const { return completed_us_; }
+
+private:
+    uint64_t id_;
+    int64_t requested_us_;
+    int64_t target_us_;
+    std::vector<CameraResult> results_;
+    std::atomic<int> remaining_;
+    int64_t completed_us_ = 0;
+    Callback on_complete_;
+};
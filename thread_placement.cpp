@@ -0,0 +1,180 @@
+#include "thread_placement.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+
+namespace {
+
+// 读取 sysfs 文件的第一行
+std::string read_sysfs_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+// 解析 "0-3,6" 形式的列表
+bool parse_cpu_list(const std::string& list, std::vector<int>& cpus) {
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) {
+            continue;
+        }
+        char* end = nullptr;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-') {
+            const char* second = end + 1;
+            last = std::strtol(second, &end, 10);
+            if (end == second) {
+                return false;
+            }
+        }
+        if (*end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+// 按 cpu_capacity（ARM 大小核）或最高频率把在线CPU分组，键越大越快
+std::map<long, std::vector<int>> cpu_clusters() {
+    std::vector<int> online;
+    std::map<long, std::vector<int>> clusters;
+    if (!parse_cpu_list(read_sysfs_line("/sys/devices/system/cpu/online"), online)) {
+        return clusters;
+    }
+    for (int cpu : online) {
+        std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        std::string value = read_sysfs_line(dir + "/cpu_capacity");
+        if (value.empty()) {
+            value = read_sysfs_line(dir + "/cpufreq/cpuinfo_max_freq");
+        }
+        clusters[value.empty() ? 0 : std::atol(value.c_str())].push_back(cpu);
+    }
+    return clusters;
+}
+
+// 检查集合中的CPU都在本进程允许运行的范围内（在线且不受 taskset/cgroup 限制）
+bool check_allowed(const std::vector<int>& cpus, std::string& error) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+        return true;
+    }
+    for (int cpu : cpus) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            error = "CPU " + std::to_string(cpu) + " 不在本进程可用的CPU中";
+            return false;
+        }
+    }
+    return true;
+}
+
+// 按写法展开为CPU列表，不检查是否可用
+bool parse_cpu_spec(const std::string& spec, std::vector<int>& cpus, std::string& error) {
+    if (spec == "big" || spec == "little") {
+        auto clusters = cpu_clusters();
+        if (clusters.empty()) {
+            error = "无法读取在线CPU列表";
+            return false;
+        }
+        if (clusters.size() == 1) {
+            error = "CPU没有大小核之分";
+            return false;
+        }
+        if (spec == "big") {
+            cpus = clusters.rbegin()->second;
+        } else {
+            for (auto it = clusters.begin(); it != std::prev(clusters.end()); ++it) {
+                cpus.insert(cpus.end(), it->second.begin(), it->second.end());
+            }
+            std::sort(cpus.begin(), cpus.end());
+        }
+        return true;
+    }
+    if (spec.rfind("node", 0) == 0) {
+        std::string path = "/sys/devices/system/node/" + spec + "/cpulist";
+        if (!parse_cpu_list(read_sysfs_line(path), cpus)) {
+            error = "无法读取 " + path;
+            return false;
+        }
+        return true;
+    }
+    if (!parse_cpu_list(spec, cpus)) {
+        error = "无效的CPU列表";
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool parse_cpu_set(const std::string& spec, std::vector<int>& cpus, std::string& error) {
+    cpus.clear();
+    return parse_cpu_spec(spec, cpus, error) && check_allowed(cpus, error);
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus) {
+    std::string out;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        if (!out.empty()) {
+            out += ",";
+        }
+        out += std::to_string(cpus[i]);
+        if (j > i) {
+            out += "-" + std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return out;
+}
+
+void apply_thread_placement(const std::string& name, const ThreadPlacement& placement) {
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+    if (!placement.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : placement.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (error != 0) {
+            std::cerr << "绑定线程 " << name << " 到CPU " << format_cpu_list(placement.cpus) << " 失败：" << strerror(error)
+                      << std::endl;
+        }
+    }
+
+    if (placement.rt_priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = placement.rt_priority;
+        int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (error != 0) {
+            std::cerr << "设置线程 " << name << " 为 SCHED_FIFO " << placement.rt_priority << " 失败：" << strerror(error);
+            if (error == EPERM) {
+                std::cerr << "（需要 CAP_SYS_NICE 或足够的 RLIMIT_RTPRIO）";
+            }
+            std::cerr << std::endl;
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// 线程的CPU绑定和调度策略。采集、写盘和预览线程可以分别放到不同的核上，
+// 避免互相抢占（大小核的 ARM 板上尤其明显）。
+//
+// CPU 集合的写法：
+//   0-3,6    CPU 列表
+//   big      大核：cpu_capacity 最高的一组（没有 cpu_capacity 时按最高频率）
+//   little   小核：其余的核
+//   node1    NUMA 节点1的所有CPU
+
+struct ThreadPlacement {
+    std::vector<int> cpus;  // 为空表示不绑定
+    int rt_priority = 0;    // SCHED_FIFO 优先级（1~99），0表示普通调度
+};
+
+// 解析 CPU 集合，失败时返回false并在 error 中给出原因
+bool parse_cpu_set(const std::string& spec, std::vector<int>& cpus, std::string& error);
+
+// 输出为 "0-3,6" 的形式
+std::string format_cpu_list(const std::vector<int>& cpus);
+
+// 设置当前线程的名称（top -H、perf 中可见，最多15个字符），并按 placement 绑定CPU、设置调度策略。
+// 失败时输出原因，线程继续以原来的方式运行
+void apply_thread_placement(const std::string& name, const ThreadPlacement& placement);
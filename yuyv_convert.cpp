@@ -0,0 +1,231 @@
+#include "yuyv_convert.h"
+
+#include <algorithm>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define YUYV_X86 1
+#endif
+
+namespace {
+
+// BT.601 有限范围系数，Q14 定点
+constexpr int COEF_SHIFT = 14;
+constexpr int COEF_ROUND = 1 << (COEF_SHIFT - 1);
+constexpr int COEF_Y = 19077;     // 1.164
+constexpr int COEF_VR = 26149;    // 1.596
+constexpr int COEF_VG = -13320;   // -0.813
+constexpr int COEF_UG = -6406;    // -0.391
+constexpr int COEF_UB = 33063;    // 2.018
+
+inline uint8_t clamp_u8(int value) {
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+inline void yuv_to_bgr(int y, int u, int v, uint8_t* out) {
+    int luma = std::max(y - 16, 0) * COEF_Y + COEF_ROUND;
+    u -= 128;
+    v -= 128;
+    out[0] = clamp_u8((luma + COEF_UB * u) >> COEF_SHIFT);
+    out[1] = clamp_u8((luma + COEF_UG * u + COEF_VG * v) >> COEF_SHIFT);
+    out[2] = clamp_u8((luma + COEF_VR * v) >> COEF_SHIFT);
+}
+
+// 按最近邻选取的源行
+inline int source_row(int y, int src_height, int dst_height) {
+    return static_cast<int>((2LL * y + 1) * src_height / (2LL * dst_height));
+}
+
+// 宽度减半：从 x 号宏像素开始转换到行尾
+void halve_row_scalar(const uint8_t* src, uint8_t* dst, int x, int width) {
+    for (; x < width; ++x) {
+        const uint8_t* p = src + x * 4;
+        yuv_to_bgr((p[0] + p[2] + 1) >> 1, p[1], p[3], dst + x * 3);
+    }
+}
+
+// 任意比例：每个输出像素最近邻采样
+void sample_row_scalar(const uint8_t* src, int src_width, uint8_t* dst, int dst_width) {
+    for (int x = 0; x < dst_width; ++x) {
+        int sx = static_cast<int>((2LL * x + 1) * src_width / (2LL * dst_width));
+        const uint8_t* pair = src + (sx & ~1) * 2;
+        yuv_to_bgr(pair[(sx & 1) * 2], pair[1], pair[3], dst + x * 3);
+    }
+}
+
+using HalveRow = void (*)(const uint8_t* src, uint8_t* dst, int width);
+
+void halve_row_scalar_full(const uint8_t* src, uint8_t* dst, int width) {
+    halve_row_scalar(src, dst, 0, width);
+}
+
+#if defined(__aarch64__)
+
+// 每次处理8个宏像素：vld4 直接把 Y0/U/Y1/V 拆到四个向量，vst3 交织写出 BGR
+void halve_row_neon(const uint8_t* src, uint8_t* dst, int width) {
+    const int32x4_t round = vdupq_n_s32(COEF_ROUND);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t yuyv = vld4_u8(src + x * 4);
+        uint8x8_t y8 = vrhadd_u8(yuyv.val[0], yuyv.val[2]);
+        int16x8_t y16 = vreinterpretq_s16_u16(vqsubq_u16(vmovl_u8(y8), vdupq_n_u16(16)));
+        int16x8_t u16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[1])), vdupq_n_s16(128));
+        int16x8_t v16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(yuyv.val[3])), vdupq_n_s16(128));
+
+        int16x4_t yh[2] = {vget_low_s16(y16), vget_high_s16(y16)};
+        int16x4_t uh[2] = {vget_low_s16(u16), vget_high_s16(u16)};
+        int16x4_t vh[2] = {vget_low_s16(v16), vget_high_s16(v16)};
+        int16x4_t b[2], g[2], r[2];
+        for (int h = 0; h < 2; ++h) {
+            int32x4_t luma = vmlaq_n_s32(round, vmovl_s16(yh[h]), COEF_Y);
+            int32x4_t u = vmovl_s16(uh[h]);
+            int32x4_t v = vmovl_s16(vh[h]);
+            b[h] = vqshrn_n_s32(vmlaq_n_s32(luma, u, COEF_UB), COEF_SHIFT);
+            g[h] = vqshrn_n_s32(vmlaq_n_s32(vmlaq_n_s32(luma, u, COEF_UG), v, COEF_VG), COEF_SHIFT);
+            r[h] = vqshrn_n_s32(vmlaq_n_s32(luma, v, COEF_VR), COEF_SHIFT);
+        }
+        uint8x8x3_t bgr;
+        bgr.val[0] = vqmovun_s16(vcombine_s16(b[0], b[1]));
+        bgr.val[1] = vqmovun_s16(vcombine_s16(g[0], g[1]));
+        bgr.val[2] = vqmovun_s16(vcombine_s16(r[0], r[1]));
+        vst3_u8(dst + x * 3, bgr);
+    }
+    halve_row_scalar(src, dst, x, width);
+}
+
+#elif defined(YUYV_X86)
+
+// x86 上每个宏像素正好是一个32位整数（小端：Y0 | U<<8 | Y1<<16 | V<<24），
+// 按32位通道拆分后直接做定点运算
+
+// 把8个像素的 B/G/R（各8个 int16）交织成24字节写出
+__attribute__((target("sse4.1")))
+inline void store_bgr8(__m128i b16, __m128i g16, __m128i r16, uint8_t* dst) {
+    const __m128i bg = _mm_packus_epi16(b16, g16);  // b0..b7 g0..g7
+    const __m128i rr = _mm_packus_epi16(r16, r16);  // r0..r7 r0..r7
+    const __m128i bg_lo = _mm_setr_epi8(0, 8, -1, 1, 9, -1, 2, 10, -1, 3, 11, -1, 4, 12, -1, 5);
+    const __m128i rr_lo = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i bg_hi = _mm_setr_epi8(13, -1, 6, 14, -1, 7, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i rr_hi = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+    __m128i lo = _mm_or_si128(_mm_shuffle_epi8(bg, bg_lo), _mm_shuffle_epi8(rr, rr_lo));
+    __m128i hi = _mm_or_si128(_mm_shuffle_epi8(bg, bg_hi), _mm_shuffle_epi8(rr, rr_hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), lo);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16), hi);
+}
+
+// 4个宏像素 -> 4个像素的 B/G/R（int32）
+__attribute__((target("sse4.1")))
+inline void convert4_sse(__m128i px, __m128i& b, __m128i& g, __m128i& r) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    __m128i y0 = _mm_and_si128(px, mask);
+    __m128i u = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(px, 8), mask), _mm_set1_epi32(128));
+    __m128i y1 = _mm_and_si128(_mm_srli_epi32(px, 16), mask);
+    __m128i v = _mm_sub_epi32(_mm_srli_epi32(px, 24), _mm_set1_epi32(128));
+    __m128i y = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(y0, y1), _mm_set1_epi32(1)), 1);
+    y = _mm_max_epi32(_mm_sub_epi32(y, _mm_set1_epi32(16)), _mm_setzero_si128());
+    __m128i luma = _mm_add_epi32(_mm_mullo_epi32(y, _mm_set1_epi32(COEF_Y)), _mm_set1_epi32(COEF_ROUND));
+    b = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(u, _mm_set1_epi32(COEF_UB))), COEF_SHIFT);
+    g = _mm_srai_epi32(_mm_add_epi32(luma, _mm_add_epi32(_mm_mullo_epi32(u, _mm_set1_epi32(COEF_UG)),
+                                                         _mm_mullo_epi32(v, _mm_set1_epi32(COEF_VG)))), COEF_SHIFT);
+    r = _mm_srai_epi32(_mm_add_epi32(luma, _mm_mullo_epi32(v, _mm_set1_epi32(COEF_VR))), COEF_SHIFT);
+}
+
+__attribute__((target("sse4.1")))
+void halve_row_sse41(const uint8_t* src, uint8_t* dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i b0, g0, r0, b1, g1, r1;
+        convert4_sse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4)), b0, g0, r0);
+        convert4_sse(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4 + 16)), b1, g1, r1);
+        store_bgr8(_mm_packs_epi32(b0, b1), _mm_packs_epi32(g0, g1), _mm_packs_epi32(r0, r1), dst + x * 3);
+    }
+    halve_row_scalar(src, dst, x, width);
+}
+
+__attribute__((target("avx2")))
+void halve_row_avx2(const uint8_t* src, uint8_t* dst, int width) {
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i bias = _mm256_set1_epi32(128);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+        __m256i y0 = _mm256_and_si256(px, mask);
+        __m256i u = _mm256_sub_epi32(_mm256_and_si256(_mm256_srli_epi32(px, 8), mask), bias);
+        __m256i y1 = _mm256_and_si256(_mm256_srli_epi32(px, 16), mask);
+        __m256i v = _mm256_sub_epi32(_mm256_srli_epi32(px, 24), bias);
+        __m256i y = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(y0, y1), _mm256_set1_epi32(1)), 1);
+        y = _mm256_max_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(16)), _mm256_setzero_si256());
+        __m256i luma = _mm256_add_epi32(_mm256_mullo_epi32(y, _mm256_set1_epi32(COEF_Y)), _mm256_set1_epi32(COEF_ROUND));
+        __m256i b = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(u, _mm256_set1_epi32(COEF_UB))), COEF_SHIFT);
+        __m256i g = _mm256_srai_epi32(
+            _mm256_add_epi32(luma, _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(COEF_UG)),
+                                                    _mm256_mullo_epi32(v, _mm256_set1_epi32(COEF_VG)))),
+            COEF_SHIFT);
+        __m256i r = _mm256_srai_epi32(_mm256_add_epi32(luma, _mm256_mullo_epi32(v, _mm256_set1_epi32(COEF_VR))), COEF_SHIFT);
+        store_bgr8(_mm_packs_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1)),
+                   _mm_packs_epi32(_mm256_castsi256_si128(g), _mm256_extracti128_si256(g, 1)),
+                   _mm_packs_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)), dst + x * 3);
+    }
+    halve_row_scalar(src, dst, x, width);
+}
+
+#endif
+
+struct Kernel {
+    HalveRow halve_row;
+    const char* name;
+};
+
+Kernel select_kernel() {
+#if defined(__aarch64__)
+    return {halve_row_neon, "neon"};
+#elif defined(YUYV_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {halve_row_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return {halve_row_sse41, "sse4.1"};
+    }
+    return {halve_row_scalar_full, "scalar"};
+#else
+    return {halve_row_scalar_full, "scalar"};
+#endif
+}
+
+const Kernel& kernel() {
+    static const Kernel selected = select_kernel();
+    return selected;
+}
+
+void convert(HalveRow halve_row, const uint8_t* src, int src_width, int src_height, size_t src_stride,
+             uint8_t* dst, int dst_width, int dst_height, size_t dst_stride) {
+    bool halve = dst_width * 2 == src_width;
+    for (int y = 0; y < dst_height; ++y) {
+        const uint8_t* src_row = src + source_row(y, src_height, dst_height) * src_stride;
+        uint8_t* dst_row = dst + y * dst_stride;
+        if (halve) {
+            halve_row(src_row, dst_row, dst_width);
+        } else {
+            sample_row_scalar(src_row, src_width, dst_row, dst_width);
+        }
+    }
+}
+
+}  // namespace
+
+void yuyv_to_bgr_downscale(const uint8_t* src, int src_width, int src_height, size_t src_stride,
+                           uint8_t* dst, int dst_width, int dst_height, size_t dst_stride) {
+    convert(kernel().halve_row, src, src_width, src_height, src_stride, dst, dst_width, dst_height, dst_stride);
+}
+
+void yuyv_to_bgr_downscale_scalar(const uint8_t* src, int src_width, int src_height, size_t src_stride,
+                                  uint8_t* dst, int dst_width, int dst_height, size_t dst_stride) {
+    convert(halve_row_scalar_full, src, src_width, src_height, src_stride, dst, dst_width, dst_height, dst_stride);
+}
+
+const char* yuyv_kernel_name() {
+    return kernel().name;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// YUYV（YUV 4:2:2）直接转换为缩小后的 BGR 图像，颜色转换和缩放一次完成，
+// 不产生全尺寸的中间 BGR 图像。颜色按 BT.601 有限范围计算（与 OpenCV 的
+// COLOR_YUV2BGR_YUYV 相同）。
+//
+// 宽度正好减半时，每个 YUYV 宏像素（Y0 U Y1 V）输出一个像素，Y 取两者的平均值，
+// 这一路径在 aarch64 上用 NEON、在 x86 上按CPU支持选用 AVX2 或 SSE4.1 实现；
+// 其他比例使用标量最近邻采样。行总是按最近邻选取。
+// SIMD 实现与标量实现逐字节一致。
+
+// 转换 src（src_width x src_height，行跨度 src_stride 字节）到 dst
+// （dst_width x dst_height，3通道，行跨度 dst_stride 字节）。
+// src_width 必须为偶数，dst 尺寸不能大于 src
+void yuyv_to_bgr_downscale(const uint8_t* src, int src_width, int src_height, size_t src_stride,
+                           uint8_t* dst, int dst_width, int dst_height, size_t dst_stride);
+
+// 只用标量代码的实现，用于校验和基准对比
+void yuyv_to_bgr_downscale_scalar(const uint8_t* src, int src_width, int src_height, size_t src_stride,
+                                  uint8_t* dst, int dst_width, int dst_height, size_t dst_stride);
+
+// 运行时选用的实现名称（"neon"、"avx2"、"sse4.1" 或 "scalar"）
+const char* yuyv_kernel_name();